@@ -15,59 +15,44 @@ TEMPLATE = app
 
 ICON = icon.icns
 
+include(solver.pri)
+
 SOURCES += main.cpp\
         fdtd.cpp \
     qcustomplot.cpp \
     preferences.cpp \
-    settings.cpp \
-    field.cpp \
-    area.cpp \
-    pmlboundary.cpp \
-    currentsource.cpp \
     sourcesettings.cpp \
-    materialdefinition.cpp \
     materialsettings.cpp \
-    planewave.cpp \
-    point.cpp \
+    thinsettings.cpp \
     tfsfsettings.cpp \
-    pointinpolygon.cpp \
-    sensordefinition.cpp \
     sensorresult.cpp \
     sensorsettings.cpp \
-    coordinatetable.cpp \
     inputrange.cpp \
-    sgfield.cpp \
-    sginterface.cpp \
-    sgsettings.cpp
+    sgsettings.cpp \
+    coordinatetable.cpp \
+    simulation.cpp \
+    projectfile.cpp
 
 HEADERS  += fdtd.h \
     qcustomplot.h \
     preferences.h \
-    settings.h \
-    field.h \
-    area.h \
-    pmlboundary.h \
-    currentsource.h \
     sourcesettings.h \
-    materialdefinition.h \
     materialsettings.h \
-    planewave.h \
-    point.h \
+    thinsettings.h \
     tfsfsettings.h \
-    pointinpolygon.h \
-    sensordefinition.h \
     sensorresult.h \
     sensorsettings.h \
-    coordinatetable.h \
     inputrange.h \
-    sgfield.h \
-    sginterface.h \
-    sgsettings.h
+    sgsettings.h \
+    coordinatetable.h \
+    simulation.h \
+    projectfile.h
 
 FORMS    += fdtd.ui \
     preferences.ui \
     sourcesettings.ui \
     materialsettings.ui \
+    thinsettings.ui \
     tfsfsettings.ui \
     sensorresult.ui \
     sensorsettings.ui \
@@ -79,11 +64,3 @@ DISTFILES += \
 
 RESOURCES += \
     resources.qrc
-
-#INCLUDEPATH += "C:/fftwMinGW"
-
-QMAKE_CXXFLAGS += -O3
-#QMAKE_CXXFLAGS+= -openmp
-#QMAKE_LFLAGS +=  -openmp
-
-LIBS += -L/usr/local/lib -lfftw3
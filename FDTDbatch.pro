@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Headless batch runner, no display server needed
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = FDTDbatch
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(solver.pri)
+
+SOURCES += batch.cpp \
+    projectfile.cpp
+
+HEADERS += projectfile.h
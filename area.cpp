@@ -33,4 +33,5 @@ Area& Area::operator=(const Area& a)
     this->iMin = a.iMin;
     this->jMax = a.jMax;
     this->jMin = a.jMin;
+    return *this;
 }
@@ -19,7 +19,6 @@
 #ifndef AREA_H
 #define AREA_H
 
-#include <qdebug.h>
 
 class Area
 {
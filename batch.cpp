@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <thread>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "projectfile.h"
+#include "engine.h"
+#include "resourceestimate.h"
+#include "subgridplacement.h"
+
+//
+// Headless runner: loads a .bdd project, runs it on all cores and writes the results to text files
+// Qt is only used for the command line and the project file, the solver itself does not need it
+//
+void writeSensors(const QDir &dir, const std::vector<SensorDefinition> &sensors, double dt)
+{
+    for(int k=0; k<sensors.size(); k++) {
+        QFile f(dir.filePath("sensor"+QString::number(k)+".csv"));
+        if(!f.open(QIODevice::WriteOnly))
+            continue;
+
+        QTextStream stream(&f);
+        stream << "t,Ex,Ey,Hz" << endl;
+        for(int n=0; n<sensors[k].size; n++)
+            stream << n*dt << "," << sensors[k].Ex[n] << "," << sensors[k].Ey[n] << "," << sensors[k].Hz[n] << endl;
+        f.close();
+    }
+}
+
+void writeSolverStatistics(const QDir &dir, const std::vector<SGInterface> &hsgSurfaces, int steps)
+{
+    for(int k=0; k<hsgSurfaces.size(); k++) {
+        const SGField *FB = hsgSurfaces[k].FB;
+        if(FB->solverType != SGField::Iterative && FB->solverType != SGField::ADI)
+            continue;                   // The other solvers are exact or do not solve a system
+
+        QFile f(dir.filePath("subgrid"+QString::number(k)+".csv"));
+        if(!f.open(QIODevice::WriteOnly))
+            continue;
+
+        QTextStream stream(&f);
+        stream << "n,iterations,residual" << endl;
+        int total = 0, most = 0;
+        double worst = 0;
+        for(int n=0; n<steps; n++) {
+            stream << n << "," << FB->solverIterations[n] << "," << FB->solverResidual[n] << endl;
+            total += FB->solverIterations[n];
+            most = std::max(most, FB->solverIterations[n]);
+            worst = std::max(worst, FB->solverResidual[n]);
+        }
+        f.close();
+        printf("Subgrid %d: %.1f iterations per step (at most %d), largest relative residual %g\n", k, (double)total/std::max(steps, 1), most, worst);
+    }
+}
+
+void writeSnapshots(const QDir &dir, Engine &engine)
+{
+    const char *names[3] = {"Ex", "Ey", "Hz"};
+    int sampleDistance = engine.field->settings.sampleDistance;
+
+    for(int n=0; n<engine.frames(); n++) {
+        for(int m=0; m<3; m++) {
+            QFile f(dir.filePath(QString(names[m])+"_"+QString::number(n*sampleDistance)+".txt"));
+            if(!f.open(QIODevice::WriteOnly))
+                continue;
+
+            Engine::FieldView v = engine.view((Engine::Component)m, n);
+            QTextStream stream(&f);
+            for(int j=v.PMLlayers; j<v.ny-v.PMLlayers; j++) {       // One row per y, the PML is left out
+                for(int i=v.PMLlayers; i<v.nx-v.PMLlayers; i++)
+                    stream << v(i, j) << (i<v.nx-v.PMLlayers-1? " " : "");
+                stream << endl;
+            }
+            f.close();
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("FDTDbatch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a .bdd project without user interface.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("project", "The .bdd file to run.");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Directory for the results (default: current directory).", "directory", ".");
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads", "Number of threads, at least 2 (default: number of cores).", "n");
+    QCommandLineOption budgetOption("budget", "Memory budget in MB, the sample distance is increased to fit.", "MB");
+    QCommandLineOption estimateOption("estimate", "Only print the resource estimate.");
+    QCommandLineOption noSnapshotsOption("no-snapshots", "Only write the sensors.");
+    QCommandLineOption placeOption("place-subgrids", "Add subgrids around the structures the main grid does not resolve.");
+    parser.addOption(outputOption);
+    parser.addOption(threadsOption);
+    parser.addOption(budgetOption);
+    parser.addOption(estimateOption);
+    parser.addOption(noSnapshotsOption);
+    parser.addOption(placeOption);
+    parser.process(a);
+
+    if(parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QFile f(parser.positionalArguments()[0]);
+    if(!f.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Cannot open %s\n", qPrintable(f.fileName()));
+        return 1;
+    }
+
+    Settings settings;
+    std::vector<MaterialDefinition> materials;
+    std::vector<ThinDefinition> thin;
+    std::vector<currentSource> currentSources;
+    std::vector<PlaneWave> TFSF;
+    std::vector<SensorDefinition> sensors;
+    std::vector<SGInterface> hsgSurfaces;
+
+    QTextStream stream(&f);
+    ProjectFile::read(stream, settings, materials, thin, currentSources, TFSF, sensors, hsgSurfaces);
+    f.close();
+
+    settings.numberOfThreads = std::max(2, parser.isSet(threadsOption)? parser.value(threadsOption).toInt() : (int)std::thread::hardware_concurrency());   // One thread is always kept for the boundary
+
+    if(parser.isSet(placeOption)) {
+        SubgridPlacement placement(settings, materials, ResourceEstimate(settings, currentSources, materials, TFSF, sensors, hsgSurfaces).maxFrequency);
+        std::vector<SGInterface> proposed = placement.propose(hsgSurfaces);
+        for(int k=0; k<proposed.size(); k++) {
+            printf("Subgrid (%g, %g) - (%g, %g), ratio %g by %g\n", proposed[k].p[0].x, proposed[k].p[0].y, proposed[k].p[1].x, proposed[k].p[1].y,
+                   proposed[k].xRatio, proposed[k].yRatio);
+            hsgSurfaces.push_back(proposed[k]);
+        }
+        if(placement.minimumCellsX() > 0 && (placement.minimumCellsX() < settings.cellsX || placement.minimumCellsY() < settings.cellsY))
+            printf("The free-space wavelength only needs %d by %d main grid cells\n", placement.minimumCellsX(), placement.minimumCellsY());
+    }
+
+    ResourceEstimate estimate(settings, currentSources, materials, TFSF, sensors, hsgSurfaces);
+    if(parser.isSet(budgetOption)) {
+        settings.memoryBudget = parser.value(budgetOption).toInt();
+        double budget = settings.memoryBudget*1024.0*1024.0;
+        if(estimate.totalBytes() > budget) {
+            int sampleDistance = estimate.fitSampleDistance(budget);
+            if(sampleDistance <= 0 || sampleDistance > estimate.nyquistSampleDistance()) {
+                fprintf(stderr, "The project does not fit in %d MB.\n", settings.memoryBudget);
+                return 1;
+            }
+            settings.sampleDistance = sampleDistance;
+            estimate.setSampleDistance(sampleDistance);
+        }
+    }
+
+    if(parser.isSet(estimateOption)) {
+        estimate.calibrate();
+        printf("%s\n", estimate.summary().c_str());
+        return 0;
+    }
+
+    QDir dir(parser.value(outputOption));
+    if(!dir.mkpath(".")) {
+        fprintf(stderr, "Cannot create %s\n", qPrintable(dir.path()));
+        return 1;
+    }
+
+    Engine engine;                          // Nothing is drawn, so no callback per step
+    engine.start(settings, currentSources, materials, thin, TFSF, sensors, hsgSurfaces);
+    engine.wait();
+
+    settings.computeDifferentials();
+    writeSensors(dir, engine.field->sensors, settings.dt);
+    writeSolverStatistics(dir, engine.field->hsgSurfaces, engine.completedSteps());
+    if(!parser.isSet(noSnapshotsOption))
+        writeSnapshots(dir, engine);
+
+    return 0;
+}
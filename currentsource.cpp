@@ -44,4 +44,5 @@ currentSource& currentSource::operator=(const currentSource& a)
     this->iG = a.iG;
     this->jG = a.jG;
     this->polarizationG = a.polarizationG;
+    return *this;
 }
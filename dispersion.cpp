@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "dispersion.h"
+#include <cmath>
+
+#define epsilon0    8.8541878176E-12
+
+Dispersion::Dispersion()
+{
+}
+
+Dispersion::Pole Dispersion::pole(const MaterialDefinition &material, double dt)
+{
+    Pole p = {0, 0, 0, 0};
+    double omega = 2*M_PI*material.poleFrequency*1E6;
+    double gamma = 2*M_PI*material.damping*1E6;
+
+    // J' + gamma*J = epsilon0*omegaP^2*E
+    if(material.dispersion == 1) {
+        p.alpha = (1 - gamma*dt/2)/(1 + gamma*dt/2);
+        p.g = p.h = epsilon0*omega*omega*dt/(2*(1 + gamma*dt/2));
+    }
+
+    // P' = J, J' + gamma*J + omega0^2*P = epsilon0*deltaEps*omega0^2*E, P at n+1 written out in J at n+1
+    if(material.dispersion == 2) {
+        double w = omega*omega*dt*dt/4, A = 1 + w + gamma*dt/2;
+        p.alpha = (1 - w - gamma*dt/2)/A;
+        p.pi = -omega*omega*dt/A;
+        p.g = p.h = epsilon0*material.deltaEps*omega*omega*dt/(2*A);
+    }
+
+    // tau*J' + J = epsilon0*deltaEps*E', omega = 1/tau
+    if(material.dispersion == 3) {
+        p.alpha = (2 - omega*dt)/(2 + omega*dt);
+        p.g = 2*epsilon0*material.deltaEps*omega/(2 + omega*dt);
+        p.h = -p.g;
+    }
+    return p;
+}
+
+void Dispersion::update(Cell &cell, double &E, double EOld)
+{
+    const Pole &p = poles[cell.pole];
+    E -= cell.b*((1+p.alpha)*cell.J + p.pi*cell.P + p.h*EOld)/2;       // The current at n+1/2 is the mean of J at n and n+1, the part with E at n+1 is in b
+
+    double J = p.alpha*cell.J + p.pi*cell.P + p.g*E + p.h*EOld;
+    cell.P += dt*(J + cell.J)/2;
+    cell.J = J;
+}
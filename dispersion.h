@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DISPERSION_H
+#define DISPERSION_H
+
+#include <vector>
+#include "materialdefinition.h"
+
+//
+// Auxiliary differential equation for a Drude, Lorentz or Debye pole: the polarisation current J
+// of a cell follows from E, and only the cells of dispersive materials keep one
+// Every equation is integrated with the trapezoidal rule, so no pole can make the update unstable
+//
+class Dispersion
+{
+public:
+    struct Pole {
+        double alpha, pi, g, h;         // J at n+1 = alpha*J + pi*P + g*E at n+1 + h*E, all at n unless stated
+    };
+
+    struct Cell {
+        int patch, i, j;
+        char component;                 // 'x' for Ex, 'y' for Ey
+        int pole;
+        double b;                       // What multiplies the curl of H in the update of this cell
+        double J, P;                    // Polarisation current and, for Lorentz, polarisation at n
+    };
+
+    Dispersion();
+    static Pole pole(const MaterialDefinition &material, double dt);
+    void update(Cell &cell, double &E, double EOld);        // Take the current out of E at n+1, which the update has just computed from E at n (EOld), and advance J
+
+    double dt=0;                        // Of the poles
+    std::vector<Pole> poles;            // One for every material, unused if it has no dispersion
+    std::vector<Cell> cells;            // In the order the update visits the patches
+};
+
+#endif // DISPERSION_H
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "engine.h"
+#include <cmath>
+#include <algorithm>
+
+Engine::Engine() : stepsDone(0), running(false)
+{
+    sync.stepFinished = [this](int n) {
+        stepsDone = n+1;
+        if(stepFinished)
+            stepFinished(n);
+    };
+    sync.threadFinished = [this](double minEx, double maxEx, double minEy, double maxEy, double minHz, double maxHz) {
+        threadFinished(minEx, maxEx, minEy, maxEy, minHz, maxHz);
+    };
+}
+
+Engine::~Engine()
+{
+    cancel();
+    wait();
+    releaseThreads();
+    if(field != NULL) {
+        field->deleteFields();
+        delete field;
+    }
+}
+
+bool Engine::isRunning()
+{
+    return running;
+}
+
+bool Engine::canResume()
+{
+    return !running && field != NULL && boundary != NULL;
+}
+
+int Engine::completedSteps()
+{
+    return stepsDone;
+}
+
+int Engine::frames()
+{
+    if(field == NULL)
+        return 0;
+    return std::ceil((double)field->settings.steps/field->settings.sampleDistance);
+}
+
+Engine::FieldView Engine::view(Component component, int frame)
+{
+    FieldView v;
+    if(field == NULL || frame < 0 || frame >= frames())
+        return v;
+
+    double ***buffer = component == Ex? field->OBEx : (component == Ey? field->OBEy : field->OBHz);
+    v.data = buffer[frame];
+    v.nx = field->settings.cellsX+2*field->settings.PMLlayers;
+    v.ny = field->settings.cellsY+2*field->settings.PMLlayers;
+    v.PMLlayers = field->settings.PMLlayers;
+    return v;
+}
+
+void Engine::cancel()
+{
+    sync.cancel = true;
+}
+
+void Engine::wait()
+{
+    for(int k=0; k<(int)threads.size(); k++)
+        if(threads[k].joinable())
+            threads[k].join();
+}
+
+void Engine::start(Settings settings, const std::vector<currentSource> &currentSources, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin,
+                   std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces)
+{
+    wait();
+    releaseThreads();
+    running = true;
+
+    //
+    // Start with the definition of the main grid
+    //
+    if(field != NULL) {
+        field->deleteFields();      // seperate function, because the field is broken into pieces and given to several threads
+        delete field;               // after computation, the destructor of every thread is called, but you dont want the fields to be deleted
+    }
+
+    field = new Field(settings, &sync);
+    field->pool = &gridPool;        // Arrays released by the previous run are reused if the grid size did not change
+    field->initFields();
+    field->defineSources(currentSources);
+    this->materials = materials;        // The set-up runs on the workers, so it keeps its own copy
+    materialIndex.build(this->materials);
+    setup = field->materialStages(materialIndex, 4*settings.numberOfThreads);
+    if(setup.size() == 0)
+        setup.push_back(std::vector<std::function<void()> >());
+    this->thin = thin;
+    if(thin.size() > 0)                 // On top of the materials, the sheets may cross each other so they share a single task
+        setup.push_back(std::vector<std::function<void()> >(1, [this] { field->defineThin(this->thin); }));
+
+    for(int k=0; k<(int)sensors.size(); k++)
+        sensors[k].initVariables(settings);
+    field->sensors = sensors;
+
+    if(TFSF.size() != 0) {
+        for(int k=0; k<(int)TFSF.size(); k++) {
+            TFSF[k].settings = settings;
+            TFSF[k].computePosition();
+        }
+
+        field->TFSF = TFSF;
+    }
+
+    settings.computeDifferentials();
+    for(int k=0; k<(int)hsgSurfaces.size(); k++) {
+        hsgSurfaces[k].FA = field;          // This can only be done at runtime, because only now the settings are fixed
+        hsgSurfaces[k].computePosition(settings);   // Order is important, first assign field, then compute position
+        if(hsgSurfaces[k].FB != NULL)
+            delete hsgSurfaces[k].FB;
+
+        hsgSurfaces[k].FB = new SGField(hsgSurfaces[k].xRatio, hsgSurfaces[k].yRatio, settings, hsgSurfaces[k].p[0], hsgSurfaces[k].p[1], field->sizeWorkBuffer);
+        hsgSurfaces[k].FB->solverType = hsgSurfaces[k].solverType;
+        hsgSurfaces[k].FB->tolerance = hsgSurfaces[k].tolerance;
+        hsgSurfaces[k].FB->sync = &sync;             // Its loops share the workers
+    }
+    field->hsgSurfaces = hsgSurfaces;
+
+    // The subgrids do not depend on the main grid, their coupling and the material map need its materials, so they come last
+    for(int k=0; k<(int)hsgSurfaces.size(); k++) {
+        SGField *FB = hsgSurfaces[k].FB;
+        setup[0].push_back([this, FB] { FB->initUpdateMatrices(materialIndex); });
+    }
+
+    // Once the materials are final, every piece of the grid lists the surface of its conductors with an impedance, drops its patches inside a conductor and then lists its own dispersive cells
+    setup.push_back(std::vector<std::function<void()> >());
+    for(int k=0; k<settings.numberOfThreads-1; k++)
+        setup.back().push_back([this, k] { interior[k]->findSurfaceImpedance(materialIndex); interior[k]->maskConductors(); });
+
+    setup.push_back(std::vector<std::function<void()> >());
+    for(int k=0; k<settings.numberOfThreads-1; k++)
+        setup.back().push_back([this, k] { interior[k]->findDispersive(materialIndex); });
+
+    setup.push_back(std::vector<std::function<void()> >());
+    for(int k=0; k<(int)hsgSurfaces.size(); k++)
+        setup.back().push_back([this, k] { field->hsgSurfaces[k].initCoupling(); });
+    setup.back().push_back([this] { field->compactMaterials(); });
+
+    stepsDone = 0;
+    maxEx = 0; minEx = 0; maxEy = 0; minEy = 0; maxHz = 0; minHz = 0;
+
+    //
+    // Map the main grid onto different areas, and assign each area to a different thread
+    //
+    for(int k=0; k<settings.numberOfThreads-1; k++) {               // Keep one thread for the boundary
+        interior.push_back(new Field(settings, &sync));
+        interior[k]->shallowCopyFields(field);
+    }
+
+    for(int i=settings.PMLlayers; i<settings.cellsX+settings.PMLlayers; i++) {
+        for(int j=settings.PMLlayers; j<settings.cellsY+settings.PMLlayers; j++) {
+            bool assign = true;
+            for(int k=0; k<(int)hsgSurfaces.size(); k++) {
+                if(i >= hsgSurfaces[k].iMin - 1 &&
+                   i <= hsgSurfaces[k].iMax + 1 &&
+                   j >= hsgSurfaces[k].jMin - 1 &&
+                   j <= hsgSurfaces[k].jMax + 1)
+                    assign = false;
+            }
+            if(assign)
+                interior[i%(settings.numberOfThreads-1)]->patch.push_back(Area(i, i+1, j, j+1));
+        }
+    }
+
+    for(int k=0; k<(int)hsgSurfaces.size(); k++) {
+        for(int i=hsgSurfaces[k].iMin - 1; i <= hsgSurfaces[k].iMax + 1; i++) {
+            for(int j=hsgSurfaces[k].jMin - 1; j <=hsgSurfaces[k].jMax + 1; j++)
+//                    if(i <= hsgSurfaces[k].iMin || i >= hsgSurfaces[k].iMax || j <= hsgSurfaces[k].jMin || j >= hsgSurfaces[k].jMax)
+                    interior[k%(settings.numberOfThreads-1)]->patch.push_back(Area(i, i+1, j, j+1));
+        }
+    }
+
+    for(int k=0; k<settings.numberOfThreads-1; k++)
+        interior[k]->computeDifferentials();            // Only on startup, compute dx and such
+
+    //
+    // Finally, use the outer layer of the main grid for the boundary
+    //
+    boundary = new PMLBoundary(settings, &sync);
+    boundary->mapFields(field);     // Order is important here, because sizeWorkBuffer gets transferred here, which is needed hereafter
+    boundary->initBoundary();
+    gridPool.trim();                // Whatever the previous run left unused, is not needed anymore
+
+    launch();
+}
+
+void Engine::setUp()
+{
+    // Every worker helps with a stage and waits for the others, the last one to arrive posts the next stage
+    // A cancel only takes effect at the first step, so a cancelled run still has its materials and can be resumed
+    for(int stage=0; stage<setupStages; stage++) {
+        sync.finishTasks();
+        sync.synchronize(interior.size()+1, [this, stage] {
+            if(stage+1 < setupStages) {
+                for(int t=0; t<(int)setup[stage+1].size(); t++)
+                    sync.tasks.push_back(setup[stage+1][t]);
+            }
+            else {
+                for(int k=0; k<(int)interior.size(); k++)
+                    interior[k]->hsgSurfaces = field->hsgSurfaces;     // The copies were taken before the coupling was built
+            }
+        });
+    }
+}
+
+void Engine::resume(int extraSteps, std::vector<SensorDefinition> &sensors)
+{
+    if(!canResume())
+        return;
+
+    wait();
+    running = true;
+    setup.clear();
+    int firstStep = stepsDone;
+    int steps = firstStep + extraSteps;
+
+    //
+    // Grow everything that is indexed by the time step, the state of the grid is left untouched
+    //
+    if(steps > field->settings.steps) {
+        field->extendFields(steps);
+        // The run keeps its own sensors where they were, only those appended to the list since then are new
+        for(int k=0; k<(int)field->sensors.size(); k++)
+            field->sensors[k].extendVariables(field->settings);
+        for(int k=field->sensors.size(); k<(int)sensors.size(); k++) {
+            sensors[k].extendVariables(field->settings);
+            field->sensors.push_back(sensors[k]);
+        }
+        sensors = field->sensors;                   // The caller shares the grown arrays
+
+        for(int k=0; k<(int)field->hsgSurfaces.size(); k++)
+            field->hsgSurfaces[k].FB->extendOutput(steps);
+    }
+
+    for(int k=0; k<(int)interior.size(); k++) {
+        interior[k]->shallowCopyFields(field);      // The output buffer and the sensor arrays have moved
+        interior[k]->settings.steps = steps;
+        interior[k]->firstStep = firstStep;
+    }
+    boundary->settings.steps = steps;
+    boundary->firstStep = firstStep;
+
+    launch();                                       // Every thread resumes at firstStep
+}
+
+void Engine::launch()
+{
+    threads.clear();
+    sync.reset();
+    finishedThreads = 0;
+    sync.workers = interior.size()+1;
+
+    setupStages = setup.size();         // Only a fresh start has set-up work
+    for(int t=0; setupStages > 0 && t<(int)setup[0].size(); t++)
+        sync.tasks.push_back(setup[0][t]);
+
+    for(int k=0; k<(int)interior.size(); k++)
+        threads.push_back(std::thread([this, k] { setUp(); interior[k]->updateFields(); }));
+    threads.push_back(std::thread([this] { setUp(); boundary->updateFields(); }));
+}
+
+void Engine::threadFinished(double minEx, double maxEx, double minEy, double maxEy, double minHz, double maxHz)
+{
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        this->minEx = std::min(this->minEx, minEx);
+        this->maxEx = std::max(this->maxEx, maxEx);
+        this->minEy = std::min(this->minEy, minEy);
+        this->maxEy = std::max(this->maxEy, maxEy);
+        this->minHz = std::min(this->minHz, minHz);
+        this->maxHz = std::max(this->maxHz, maxHz);
+
+        finishedThreads++;
+        done = finishedThreads == (int)interior.size()+1;    // Every interior piece and the boundary
+    }
+
+    if(done) {
+        running = false;
+        if(finished)
+            finished();
+    }
+}
+
+void Engine::releaseThreads()
+{
+    threads.clear();
+
+    for(int k=0; k<(int)interior.size(); k++)
+        delete interior[k];
+    interior.clear();
+
+    if(boundary != NULL) {
+        delete boundary;
+        boundary = NULL;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "settings.h"
+#include "field.h"
+#include "pmlboundary.h"
+#include "gridpool.h"
+#include "threadsync.h"
+#include "currentsource.h"
+#include "materialdefinition.h"
+#include "materialindex.h"
+#include "thindefinition.h"
+#include "planewave.h"
+#include "sensordefinition.h"
+#include "sginterface.h"
+
+// Runs the main grid, its boundary and the subgrids on a pool of threads, this is the entry point of the solver library
+class Engine
+{
+public:
+    enum Component {Ex, Ey, Hz};
+
+    // One output sample of the main grid, pointing into the output buffer (no copy)
+    // Valid until the next start or resume, the PML layers are included
+    struct FieldView {
+        const double * const *data=NULL;    // data[i][j], i along x
+        int nx=0, ny=0;
+        int PMLlayers=0;                    // The computational domain starts at (PMLlayers, PMLlayers)
+        double operator()(int i, int j) const { return data[i][j]; }
+    };
+
+    Field *field=NULL;                          // The complete main grid, the threads each work on a piece of it
+    std::function<void(int)> stepFinished;      // Called after every step from a worker thread, leave empty when not needed
+    std::function<void()> finished;             // Called from a worker thread when the run is done or cancelled
+    double minEx=0, maxEx=0, minEy=0, maxEy=0, minHz=0, maxHz=0;
+
+    Engine();
+    ~Engine();
+    void start(Settings settings, const std::vector<currentSource> &currentSources, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin,
+               std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces);
+    // Continue the last run, its state is kept until the next start. Sensors appended to the list since the start
+    // record from here on, the list then holds the sensors of the run
+    void resume(int extraSteps, std::vector<SensorDefinition> &sensors);
+    void cancel();                              // Stop after the current step, the run can be resumed afterwards
+    void wait();                                // Block until the run is done
+    bool isRunning();
+    bool canResume();
+    int completedSteps();
+    int frames();
+    FieldView view(Component component, int frame);
+
+private:
+    std::vector<Field*> interior;   // This stores the cut up pieces of "field"
+    PMLBoundary *boundary=NULL;     // Currently PML is always single threaded
+    std::vector<std::thread> threads;
+    GridPool gridPool;              // Keeps the grid allocations alive between runs of the same size
+    ThreadSync sync;
+    std::mutex resultMutex;         // Protects the extrema and finishedThreads
+    int finishedThreads=0;
+    std::atomic<int> stepsDone;
+    std::atomic<bool> running;
+    std::vector<MaterialDefinition> materials;
+    MaterialIndex materialIndex;
+    std::vector<ThinDefinition> thin;
+    std::vector<std::vector<std::function<void()> > > setup;    // Material set-up of a fresh start, the tasks of a stage run at the same time
+    int setupStages=0;
+
+    void setUp();                   // Run by every worker before its first step
+
+    void launch();
+    void threadFinished(double minEx, double maxEx, double minEy, double maxEy, double minHz, double maxHz);
+    void releaseThreads();          // Join and delete the workers of the previous run
+};
+
+#endif // ENGINE_H
@@ -20,6 +20,7 @@
 #include "ui_fdtd.h"
 #include <QFileDialog>
 #include <QInputDialog>
+#include <QApplication>
 
 #define c           299792458
 #define epsilon0    8.8541878176E-12
@@ -30,6 +31,7 @@
 #define materialIndex   2
 #define sensorIndex     3
 #define hsgIndex        4
+#define thinIndex       5
 
 FDTD::FDTD(QWidget *parent) :
     QMainWindow(parent),
@@ -52,7 +54,11 @@ FDTD::FDTD(QWidget *parent) :
     connect(ui->Action_Save_As, SIGNAL(triggered()), this, SLOT(saveAsClicked()));
     connect(ui->Action_Open, SIGNAL(triggered(bool)), this, SLOT(openClicked()));
     connect(ui->Action_Export, SIGNAL(triggered(bool)), this, SLOT(exportClicked()));
+    connect(ui->Action_Estimate, SIGNAL(triggered(bool)), this, SLOT(estimateClicked()));
+    connect(ui->Action_Place_Subgrids, SIGNAL(triggered(bool)), this, SLOT(placeSubgridsClicked()));
     connect(ui->action_About, SIGNAL(triggered(bool)), this, SLOT(aboutClicked()));
+    connect(&simulation, SIGNAL(fieldUpdateFinished(int)), this, SLOT(fieldUpdateFinished(int)));
+    connect(&simulation, SIGNAL(finished()), this, SLOT(simulationFinished()));
 
     new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_Q), this, SLOT(close()));
     new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_R), this, SLOT(on_start_clicked()));
@@ -95,6 +101,9 @@ FDTD::FDTD(QWidget *parent) :
     connect(ui->customPlot, SIGNAL(mouseDoubleClick(QMouseEvent*)), this, SLOT(doubleClickedGraph(QMouseEvent*)));        // Double click to auto-resize
     connect(ui->customPlot, SIGNAL(axisDoubleClick(QCPAxis*,QCPAxis::SelectablePart,QMouseEvent*)), this, SLOT(axisLabelDoubleClick(QCPAxis*,QCPAxis::SelectablePart)));
     connect(ui->customPlot, SIGNAL(beforeReplot()), this, SLOT(beforeReplot()));
+    connect(ui->customPlot, SIGNAL(mouseMove(QMouseEvent*)), this, SLOT(graphHovered(QMouseEvent*)));                    // Show the material under the mouse
+    connect(ui->customPlot, SIGNAL(mousePress(QMouseEvent*)), this, SLOT(graphSelected(QMouseEvent*)));                  // Select the material that was clicked
+    ui->customPlot->setMouseTracking(true);
 //    connect(ui->customPlot->plotLayout()->elementAt(1), SIGNAL(mouseDoubleClickEvent(QMouseEvent *)), this, SLOT(colorScaleDoubleClick()));
 
     // Create the listview on the right hand side
@@ -108,6 +117,7 @@ FDTD::FDTD(QWidget *parent) :
     rootNode->appendRow(materialItem);
     rootNode->appendRow(sensorItem);
     rootNode->appendRow(hsgItem);
+    rootNode->appendRow(thinItem);
 
     //register the model
     ui->GridObjects->setModel(list);
@@ -126,6 +136,8 @@ FDTD::FDTD(QWidget *parent) :
     SensorItemsContextMenu = new QMenu(ui->GridObjects);
     hsgContextMenu = new QMenu(ui->GridObjects);
     hsgItemsContextMenu = new QMenu(ui->GridObjects);
+    thinContextMenu = new QMenu(ui->GridObjects);
+    thinItemsContextMenu = new QMenu(ui->GridObjects);
 
     sourcesContextMenu->addAction("Add new current source", this, SLOT(sourcesAppend()));
     sourcesItemsContextMenu->addAction("Settings", this, SLOT(sourcesItemsSettings()));
@@ -144,6 +156,9 @@ FDTD::FDTD(QWidget *parent) :
     hsgContextMenu->addAction("Add new subgridding region", this, SLOT(hsgAppend()));
     hsgItemsContextMenu->addAction("Settings", this, SLOT(hsgItemSettings()));
     hsgItemsContextMenu->addAction("Delete", this, SLOT(hsgItemsDelete()));
+    thinContextMenu->addAction("Add new sheet or wire", this, SLOT(thinAppend()));
+    thinItemsContextMenu->addAction("Settings", this, SLOT(thinItemsSettings()));
+    thinItemsContextMenu->addAction("Delete", this, SLOT(thinItemsDelete()));
 }
 
 FDTD::~FDTD()
@@ -197,7 +212,7 @@ void FDTD::openClicked()
         QTextStream stream( &f );
 
         int reply = QMessageBox::Yes;
-        if(materials.size() > 0 || currentSources.size() > 0 || sensors.size() > 0 || TFSF.size() > 0 || hsgSurfaces.size() > 0) {
+        if(materials.size() > 0 || thin.size() > 0 || currentSources.size() > 0 || sensors.size() > 0 || TFSF.size() > 0 || hsgSurfaces.size() > 0) {
             QMessageBox msgBox;
             msgBox.setIcon(QMessageBox::Warning);
             msgBox.setText("Do you wish to delete all objects?");
@@ -229,84 +244,47 @@ void FDTD::openClicked()
             while(hsgItem->rowCount() > 0)
                 hsgItem->removeRow(0);
 
+            thin.clear();
+            while(thinItem->rowCount() > 0)
+                thinItem->removeRow(0);
+
+            ProjectFile::read(stream, settings, materials, thin, currentSources, TFSF, sensors, hsgSurfaces);
+            materialLookup.build(materials);
+            setupChanged();
+
             QString title;
-            do {
-                int header;
-                stream >> header;       // Read the header
-
-                switch(header)
-                {
-                case settingsIndex:
-                    stream >> settings.cellsX >> settings.cellsY >> settings.sizeX >> settings.sizeY >> settings.courant;
-                    stream >> settings.sigmaXMax >> settings.sigmaYMax;
-                    stream >> settings.m >> settings.steps >> settings.numberOfThreads >> settings.PMLlayers;
-                    stream >> settings.width >> settings.height >> settings.sampleDistance >> settings.drawNthField;
-                    break;
-
-                case materialIndex: {
-                    int points;
-                    stream >> points;
-                    MaterialDefinition m;
-                    m.p.clear();
-
-                    for(int n=0; n<points; n++) {
-                        double x, y;
-                        stream >> x >> y;
-                        m.p.push_back(Point(x, y));
-                    }
+            for(int k=0; k<materials.size(); k++) {
+                title = QString::number(materials[k].p.size())+": ("+QString::number(materials[k].p[0].x)+", "+QString::number(materials[k].p[0].y)+")";
+                materialItem->appendRow(new QStandardItem(title));
+            }
 
-                    stream >> m.epsr >> m.mur >> m.sigma >> m.YuMittra;
-                    materials.push_back(m);
-
-                    title = QString::number(m.p.size())+": ("+QString::number(m.p[0].x)+", "+QString::number(m.p[0].y)+")";
-                    materialItem->appendRow(new QStandardItem(title));
-                    break; }
-
-                case sourceIndex: {
-                    currentSource s;
-                    stream >> s.frequency >> s.magnitude >> s.xpos >> s.ypos;
-                    s.polarization = stream.readLine(2)[1].toLatin1();
-                    s.type = stream.readLine(2)[1].toLatin1();
-                    stream >> s.timeDelay >> s.pulseWidth >> s.frequencyG >> s.magnitudeG >> s.xposG >> s.yposG;
-                    s.polarizationG = stream.readLine(2)[1].toLatin1();
-
-                    currentSources.push_back(s);
-
-                    if(s.type == 's')
-                        title = "S ("+QString::number(s.xpos)+", "+QString::number(s.ypos)+")";
-                    else
-                        title = "G ("+QString::number(s.xposG)+", "+QString::number(s.yposG)+")";
-                    sourceItem->appendRow(new QStandardItem(title));
-                    break; }
-
-                case TFSFIndex: {
-                    PlaneWave p;
-                    stream >> p.timeDelay >> p.pulseWidth >> p.centerFrequency >> p.angle >> p.amplitude >> p.p[0].x >> p.p[0].y >> p.p[1].x >> p.p[1].y;
-                    TFSF.push_back(p);
-
-                    title = "("+QString::number(p.p[0].x)+", "+QString::number(p.p[0].y)+") - ("+QString::number(p.p[1].x)+", "+QString::number(p.p[1].y)+")";
-                    TFSFItem->appendRow(new QStandardItem(title));
-                    break; }
-
-                case sensorIndex: {
-                    SensorDefinition s;
-                    stream >> s.xpos >> s.ypos;
-                    sensors.push_back(s);
-
-                    title = "("+QString::number(s.xpos)+", "+QString::number(s.ypos)+")";
-                    sensorItem->appendRow(new QStandardItem(title));
-                    break; }
-
-                case hsgIndex: {
-                    SGInterface h;
-                    stream >> h.p[0].x >> h.p[0].y >> h.p[1].x >> h.p[1].y >> h.xRatio >> h.yRatio;
-                    hsgSurfaces.push_back(h);
-
-                    title = "("+QString::number(h.p[0].x)+", "+QString::number(h.p[0].y)+") - ("+QString::number(h.p[1].x)+", "+QString::number(h.p[1].y)+")";
-                    hsgItem->appendRow(new QStandardItem(title));
-                    break; }
-                }
-            } while(!stream.atEnd());
+            for(int k=0; k<currentSources.size(); k++) {
+                if(currentSources[k].type == 's')
+                    title = "S ("+QString::number(currentSources[k].xpos)+", "+QString::number(currentSources[k].ypos)+")";
+                else
+                    title = "G ("+QString::number(currentSources[k].xposG)+", "+QString::number(currentSources[k].yposG)+")";
+                sourceItem->appendRow(new QStandardItem(title));
+            }
+
+            for(int k=0; k<TFSF.size(); k++) {
+                title = "("+QString::number(TFSF[k].p[0].x)+", "+QString::number(TFSF[k].p[0].y)+") - ("+QString::number(TFSF[k].p[1].x)+", "+QString::number(TFSF[k].p[1].y)+")";
+                TFSFItem->appendRow(new QStandardItem(title));
+            }
+
+            for(int k=0; k<sensors.size(); k++) {
+                title = "("+QString::number(sensors[k].xpos)+", "+QString::number(sensors[k].ypos)+")";
+                sensorItem->appendRow(new QStandardItem(title));
+            }
+
+            for(int k=0; k<hsgSurfaces.size(); k++) {
+                title = "("+QString::number(hsgSurfaces[k].p[0].x)+", "+QString::number(hsgSurfaces[k].p[0].y)+") - ("+QString::number(hsgSurfaces[k].p[1].x)+", "+QString::number(hsgSurfaces[k].p[1].y)+")";
+                hsgItem->appendRow(new QStandardItem(title));
+            }
+
+            for(int k=0; k<thin.size(); k++) {
+                title = (thin[k].type == 'w' ? "W (" : "S (")+QString::number(thin[k].p[0].x)+", "+QString::number(thin[k].p[0].y)+")";
+                thinItem->appendRow(new QStandardItem(title));
+            }
         }
         f.close();
 
@@ -324,85 +302,7 @@ void FDTD::saveAsClicked()
     {
         QTextStream stream( &f );
 
-        stream << settingsIndex << endl;                // Export current settings
-        stream << settings.cellsX << " ";
-        stream << settings.cellsY << " ";
-        stream << settings.sizeX << " ";
-        stream << settings.sizeY << " ";
-        stream << settings.courant << " ";
-        stream << settings.sigmaXMax << " ";
-        stream << settings.sigmaYMax << " ";
-        stream << settings.m << " ";
-        stream << settings.steps << " ";
-        stream << settings.numberOfThreads << " ";
-        stream << settings.PMLlayers << " ";
-        stream << settings.width << " ";
-        stream << settings.height << " ";
-        stream << settings.sampleDistance << " ";
-        stream << settings.drawNthField << " ";
-
-        for(int k=0; k<materials.size(); k++) {
-            stream << endl << materialIndex << " " << materials[k].p.size() << endl;
-
-            for(int n=0; n<materials[k].p.size(); n++) {
-                stream << materials[k].p[n].x << " ";
-                stream << materials[k].p[n].y << " ";
-            }
-            stream << materials[k].epsr << " ";
-            stream << materials[k].mur << " ";
-            stream << materials[k].sigma << " ";
-            stream << materials[k].YuMittra;
-        }
-
-        for(int k=0; k<currentSources.size(); k++) {
-            stream << endl << sourceIndex << endl;
-
-            stream << currentSources[k].frequency << " ";
-            stream << currentSources[k].magnitude << " ";
-            stream << currentSources[k].xpos << " ";
-            stream << currentSources[k].ypos << " ";
-            stream << currentSources[k].polarization << " ";
-            stream << currentSources[k].type << " ";
-            stream << currentSources[k].timeDelay << " ";
-            stream << currentSources[k].pulseWidth << " ";
-            stream << currentSources[k].frequencyG << " ";
-            stream << currentSources[k].magnitudeG << " ";
-            stream << currentSources[k].xposG << " ";
-            stream << currentSources[k].yposG << " ";
-            stream << currentSources[k].polarizationG;
-        }
-
-        for(int k=0; k<TFSF.size(); k++) {
-            stream << endl << TFSFIndex << endl;
-
-            stream << TFSF[k].timeDelay << " ";
-            stream << TFSF[k].pulseWidth << " ";
-            stream << TFSF[k].centerFrequency << " ";
-            stream << TFSF[k].angle << " ";
-            stream << TFSF[k].amplitude << " ";
-            stream << TFSF[k].p[0].x << " ";
-            stream << TFSF[k].p[0].y << " ";
-            stream << TFSF[k].p[1].x << " ";
-            stream << TFSF[k].p[1].y;
-        }
-
-        for(int k=0; k<sensors.size(); k++) {
-            stream << endl << sensorIndex << endl;
-
-            stream << sensors[k].xpos << " ";
-            stream << sensors[k].ypos;
-        }
-
-        for(int k=0; k<hsgSurfaces.size(); k++) {
-            stream << endl << hsgIndex << endl;
-
-            stream << hsgSurfaces[k].p[0].x << " ";
-            stream << hsgSurfaces[k].p[0].y << " ";
-            stream << hsgSurfaces[k].p[1].x << " ";
-            stream << hsgSurfaces[k].p[1].y << " ";
-            stream << hsgSurfaces[k].xRatio << " ";
-            stream << hsgSurfaces[k].yRatio;
-        }
+        ProjectFile::write(stream, settings, materials, thin, currentSources, TFSF, sensors, hsgSurfaces);
     }
     f.close();
 }
@@ -449,6 +349,75 @@ void FDTD::exportClicked()
     }
 }
 
+void FDTD::estimateClicked()
+{
+    ResourceEstimate estimate(settings, currentSources, materials, TFSF, sensors, hsgSurfaces);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    estimate.calibrate();
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox msgBox;
+    msgBox.setIcon(QMessageBox::Information);
+    msgBox.setText("Resource estimate");
+    msgBox.setInformativeText(QString::fromStdString(estimate.summary()));
+
+    double budget = settings.memoryBudget*1024.0*1024.0;
+    int sampleDistance = estimate.fitSampleDistance(budget);
+    QPushButton *fit = NULL;
+    if(sampleDistance > 0 && sampleDistance != settings.sampleDistance && sampleDistance <= estimate.nyquistSampleDistance())
+        fit = msgBox.addButton("Use sample distance "+QString::number(sampleDistance), QMessageBox::AcceptRole);    // Smallest one within the budget
+    msgBox.addButton(QMessageBox::Ok);
+    msgBox.exec();
+
+    if(fit != NULL && msgBox.clickedButton() == fit)
+        settings.sampleDistance = sampleDistance;
+}
+
+void FDTD::placeSubgridsClicked()
+{
+    SubgridPlacement placement(settings, materials, ResourceEstimate(settings, currentSources, materials, TFSF, sensors, hsgSurfaces).maxFrequency);
+    std::vector<SGInterface> proposed = placement.propose(hsgSurfaces);
+
+    QString text;
+    for(int k=0; k<proposed.size(); k++)
+        text += "("+QString::number(proposed[k].p[0].x)+", "+QString::number(proposed[k].p[0].y)+") - ("+QString::number(proposed[k].p[1].x)+", "+QString::number(proposed[k].p[1].y)+
+                "), ratio "+QString::number(proposed[k].xRatio)+" by "+QString::number(proposed[k].yRatio)+"\n";
+    if(proposed.size() == 0)
+        text = "The main grid resolves every structure, or the subgrids would overlap the ones already defined.\n";
+
+    // The main grid only has to resolve the free-space wavelength once the structures have a subgrid
+    int cellsX = std::min(placement.minimumCellsX(), settings.cellsX), cellsY = std::min(placement.minimumCellsY(), settings.cellsY);
+    bool coarsen = cellsX > 0 && cellsY > 0 && (cellsX < settings.cellsX || cellsY < settings.cellsY);
+    if(coarsen)
+        text += "\nThe free-space wavelength only needs "+QString::number(cellsX)+" by "+QString::number(cellsY)+" main grid cells.";
+
+    QMessageBox msgBox;
+    msgBox.setIcon(QMessageBox::Information);
+    msgBox.setText("Subgrid placement");
+    msgBox.setInformativeText(text);
+    QPushButton *add = NULL, *coarser = NULL;
+    if(proposed.size() > 0)
+        add = msgBox.addButton("Add subgrids", QMessageBox::AcceptRole);
+    if(coarsen)
+        coarser = msgBox.addButton("Use "+QString::number(cellsX)+" by "+QString::number(cellsY)+" cells", QMessageBox::ActionRole);
+    msgBox.addButton(QMessageBox::Cancel);
+    msgBox.exec();
+
+    if(add != NULL && msgBox.clickedButton() == add) {
+        for(int k=0; k<proposed.size(); k++) {
+            proposed[k].index = -1;
+            hsgSettingsOk(proposed[k]);
+        }
+    }
+    else if(coarser != NULL && msgBox.clickedButton() == coarser) {
+        settings.cellsX = cellsX;
+        settings.cellsY = cellsY;
+        setupChanged();
+        this->on_frameSlider_valueChanged(ui->frameSlider->value());
+        placeSubgridsClicked();         // The ratios depend on the main grid
+    }
+}
+
 void FDTD::onCustomContextMenu(const QPoint &point)
 {
     QModelIndex item = ui->GridObjects->currentIndex();
@@ -476,6 +445,9 @@ void FDTD::onCustomContextMenu(const QPoint &point)
         case hsgIndex:
             hsgContextMenu->exec(ui->GridObjects->mapToGlobal(point));
             break;
+        case thinIndex:
+            thinContextMenu->exec(ui->GridObjects->mapToGlobal(point));
+            break;
         }
     }
     else
@@ -497,6 +469,9 @@ void FDTD::onCustomContextMenu(const QPoint &point)
         case hsgIndex:
             hsgItemsContextMenu->exec(ui->GridObjects->mapToGlobal(point));
             break;
+        case thinIndex:
+            thinItemsContextMenu->exec(ui->GridObjects->mapToGlobal(point));
+            break;
         }
     }
 }
@@ -545,6 +520,7 @@ void FDTD::sourcesItemsDelete()
     currentSources.erase(currentSources.begin()+selectedIndex);
     sourceItem->removeRow(selectedIndex);
 
+    setupChanged();
     if(ui->sources->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -567,6 +543,7 @@ void FDTD::sourceSettingsOK(currentSource a)
         currentSources.insert(currentSources.begin()+a.index, a);
     }
 
+    setupChanged();
     if(ui->sources->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -611,6 +588,7 @@ void FDTD::TFSFItemsDelete()
     TFSF.erase(TFSF.begin()+selectedIndex);
     TFSFItem->removeRow(selectedIndex);
 
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -628,6 +606,7 @@ void FDTD::TFSFSettingsOk(PlaneWave a)
         TFSF.insert(TFSF.begin()+a.index, a);
     }
 
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -672,7 +651,9 @@ void FDTD::materialItemsDelete()
     int selectedIndex = ui->GridObjects->currentIndex().row();
     materials.erase(materials.begin()+selectedIndex);
     materialItem->removeRow(selectedIndex);
+    materialLookup.build(materials);
 
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -689,7 +670,76 @@ void FDTD::materialSettingsOK(MaterialDefinition a)
         materialItem->child(a.index)->setText(title);
         materials.insert(materials.begin()+a.index, a);
     }
+    materialLookup.build(materials);
 
+    setupChanged();
+    if(ui->structures->isChecked())
+        this->on_frameSlider_valueChanged(ui->frameSlider->value());
+}
+
+/////////////////
+/// \brief FDTD::thinAppend
+///
+
+void FDTD::thinAppend()
+{
+    ThinDefinition a;
+    a.index = -1;
+    thinWindow = new ThinSettings(a, points);
+    thinWindow->show();
+    plotted = false;
+
+    connect(thinWindow, SIGNAL(Ok_clicked(ThinDefinition)), this, SLOT(thinSettingsOk(ThinDefinition)));
+    connect(thinWindow, SIGNAL(drawPoint()), this, SLOT(drawPoint()));
+    connect(thinWindow, SIGNAL(drawPolygon()), this, SLOT(drawPolygon()));
+    connect(thinWindow, SIGNAL(clearLastDrawnStructure(int)), this, SLOT(clearLastDrawnStructure(int)));
+    connect(this, SIGNAL(drawingFinished()), thinWindow, SLOT(drawingFinished()));
+}
+
+void FDTD::thinItemsSettings()
+{
+    int selectedIndex = ui->GridObjects->currentIndex().row();
+    ThinDefinition a = thin[selectedIndex];
+    a.index = selectedIndex;
+    thinWindow = new ThinSettings(a, points);
+    thinWindow->show();
+    plotted = false;
+
+    connect(thinWindow, SIGNAL(Ok_clicked(ThinDefinition)), this, SLOT(thinSettingsOk(ThinDefinition)));
+    connect(thinWindow, SIGNAL(drawPoint()), this, SLOT(drawPoint()));
+    connect(thinWindow, SIGNAL(drawPolygon()), this, SLOT(drawPolygon()));
+    connect(thinWindow, SIGNAL(clearLastDrawnStructure(int)), this, SLOT(clearLastDrawnStructure(int)));
+    connect(this, SIGNAL(drawingFinished()), thinWindow, SLOT(drawingFinished()));
+}
+
+void FDTD::thinItemsDelete()
+{
+    int selectedIndex = ui->GridObjects->currentIndex().row();
+    thin.erase(thin.begin()+selectedIndex);
+    thinItem->removeRow(selectedIndex);
+
+    setupChanged();
+    if(ui->structures->isChecked())
+        this->on_frameSlider_valueChanged(ui->frameSlider->value());
+}
+
+void FDTD::thinSettingsOk(ThinDefinition a)
+{
+    if(a.p.size() == 0)
+        return;
+
+    QString title = (a.type == 'w' ? "W (" : "S (")+QString::number(a.p[0].x)+", "+QString::number(a.p[0].y)+")";
+    if(a.index == -1) {
+        thinItem->appendRow(new QStandardItem(title));
+        thin.push_back(a);
+    }
+    else {
+        thin.erase(thin.begin()+a.index);
+        thinItem->child(a.index)->setText(title);
+        thin.insert(thin.begin()+a.index, a);
+    }
+
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -736,6 +786,7 @@ void FDTD::sensorItemsDelete()
     sensors.erase(sensors.begin()+selectedIndex);
     sensorItem->removeRow(selectedIndex);
 
+    setupChanged();
     if(ui->sensors->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -759,6 +810,7 @@ void FDTD::SensorSettingsOk(SensorDefinition a)
         sensors.erase(sensors.begin()+a.index);
         sensorItem->child(a.index)->setText(title);
         sensors.insert(sensors.begin()+a.index, a);
+        setupChanged();             // A new sensor can join the run when it continues, a changed one cannot
     }
 
     if(ui->sensors->isChecked())
@@ -805,6 +857,7 @@ void FDTD::hsgItemsDelete()
     hsgSurfaces.erase(hsgSurfaces.begin()+selectedIndex);
     hsgItem->removeRow(selectedIndex);
 
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -822,6 +875,7 @@ void FDTD::hsgSettingsOk(SGInterface a)
         hsgSurfaces.insert(hsgSurfaces.begin()+a.index, a);
     }
 
+    setupChanged();
     if(ui->structures->isChecked())
         this->on_frameSlider_valueChanged(ui->frameSlider->value());
 }
@@ -963,9 +1017,32 @@ void FDTD::polygonFinished(QMouseEvent *event)
     disconnect(ui->customPlot, SIGNAL(mouseMove(QMouseEvent*)), this, SLOT(plotPolygon(QMouseEvent*)));
     disconnect(ui->customPlot, SIGNAL(mousePress(QMouseEvent*)), this, SLOT(graphClicked(QMouseEvent*)));
     connect(ui->customPlot, SIGNAL(mouseDoubleClick(QMouseEvent*)), this, SLOT(doubleClickedGraph(QMouseEvent*)));
+    numberOfPoints = 0;
     plotted = true;
 }
 
+void FDTD::graphHovered(QMouseEvent *event)
+{
+    double x = ui->customPlot->xAxis->pixelToCoord(event->pos().x());
+    double y = ui->customPlot->yAxis->pixelToCoord(event->pos().y());
+    QString text = "("+QString::number(x)+", "+QString::number(y)+")";
+
+    int k = materialLookup.materialAt(x, y);
+    if(k >= 0)
+        text += "  material "+QString::number(k+1)+": epsr "+QString::number(materials[k].epsr)+", mur "+QString::number(materials[k].mur)+", sigma "+QString::number(materials[k].sigma);
+    statusBar()->showMessage(text);
+}
+
+void FDTD::graphSelected(QMouseEvent *event)
+{
+    if(numberOfPoints != 0)         // The click belongs to a drawing
+        return;
+
+    int k = materialLookup.materialAt(ui->customPlot->xAxis->pixelToCoord(event->pos().x()), ui->customPlot->yAxis->pixelToCoord(event->pos().y()));
+    if(k >= 0)
+        ui->GridObjects->setCurrentIndex(materialItem->child(k)->index());
+}
+
 void FDTD::graphClicked(QMouseEvent* event)
 {
     numberOfPoints--;
@@ -1021,6 +1098,7 @@ void FDTD::preferencesClicked() {
 }
 
 void FDTD::preferencesClosed() {
+    setupChanged();
     this->on_frameSlider_valueChanged(ui->frameSlider->value());
     delete preferencesWindow;
     preferencesWindow = NULL;
@@ -1035,117 +1113,80 @@ void FDTD::on_start_clicked()
 {
     if(ui->start->isEnabled())
     {
+        if(!checkResources())
+            return;
+
         ui->start->setEnabled(false);
+        ui->resume->setEnabled(false);
+        ui->progressBar->setVisible(true);
+        ui->frameSlider->setVisible(false);
+        runMatchesSetup = true;
+        ui->progressBar->setMaximum(settings.steps>0? settings.steps-1 : 0);
+        ui->frameSlider->setMaximum(settings.steps>0? std::ceil((double)settings.steps/settings.sampleDistance-1) : 0);
 
-        //
-        // Start with the definition of the main grid
-        //
-        if(field != NULL) {
-            field->deleteFields();      // seperate function, because the field is broken into pieces and given to several threads
-            delete field;               // after computation, the destructor of every thread is called, but you dont want the fields to be deleted
-        }
+        simulation.start(settings, currentSources, materials, thin, TFSF, sensors, hsgSurfaces);
+        field = simulation.field;
+    }
+}
 
-        field = new Field(settings, &computation, &mutex, &threadCounter);
-        field->initFields();
-        field->defineSources(currentSources);
-        field->defineMaterial(materials);
+bool FDTD::checkResources()
+{
+    ResourceEstimate estimate(settings, currentSources, materials, TFSF, sensors, hsgSurfaces);
+    double budget = settings.memoryBudget*1024.0*1024.0;
+    if(estimate.totalBytes() <= budget)
+        return true;
 
-        for(int k=0; k<sensors.size(); k++)
-            sensors[k].initVariables(settings);
-        field->sensors = sensors;
+    int sampleDistance = estimate.fitSampleDistance(budget);
+    bool nyquist = sampleDistance > 0 && sampleDistance <= estimate.nyquistSampleDistance();
 
-        if(TFSF.size() != 0) {
-            for(int k=0; k<TFSF.size(); k++) {
-                TFSF[k].settings = settings;
-                TFSF[k].computePosition();
-            }
+    QMessageBox msgBox;
+    msgBox.setIcon(QMessageBox::Warning);
+    msgBox.setText("This simulation exceeds the memory budget of "+QString::number(settings.memoryBudget)+" MB.");
+    msgBox.setInformativeText(QString::fromStdString(estimate.summary()));
+
+    QPushButton *fit = NULL;
+    if(nyquist)     // Only offer a sample distance which still resolves the highest source frequency
+        fit = msgBox.addButton("Use sample distance "+QString::number(sampleDistance), QMessageBox::AcceptRole);
+    msgBox.addButton(QMessageBox::Ignore);
+    msgBox.addButton(QMessageBox::Cancel);
+    msgBox.exec();
 
-            field->TFSF = TFSF;
-        }
+    if(fit != NULL && msgBox.clickedButton() == fit) {
+        settings.sampleDistance = sampleDistance;
+        return true;
+    }
 
-        settings.computeDifferentials();
-        for(int k=0; k<hsgSurfaces.size(); k++) {
-            hsgSurfaces[k].FA = field;          // This can only be done at runtime, because only now the settings are fixed
-            hsgSurfaces[k].computePosition(settings);   // Order is important, first assign field, then compute position
-            if(hsgSurfaces[k].FB != NULL)
-                delete hsgSurfaces[k].FB;
-
-            hsgSurfaces[k].FB = new SGField(hsgSurfaces[k].xRatio, hsgSurfaces[k].yRatio, settings, hsgSurfaces[k].p[0], hsgSurfaces[k].p[1], field->sizeWorkBuffer);
-            hsgSurfaces[k].FB->initUpdateMatrices(materials);
-        }
-        field->hsgSurfaces = hsgSurfaces;
+    return msgBox.clickedButton() == msgBox.button(QMessageBox::Ignore);
+}
 
-        ui->progressBar->setVisible(true);
-        ui->frameSlider->setVisible(false);
-        ui->progressBar->setMaximum(settings.steps>0? settings.steps-1 : 0);
-        ui->frameSlider->setMaximum(settings.steps>0? std::ceil((double)settings.steps/settings.sampleDistance-1) : 0);
+void FDTD::setupChanged()
+{
+    runMatchesSetup = false;            // Continuing would extend a run that no longer matches what is drawn
+    ui->resume->setEnabled(false);
+}
 
-        threadCounter = 0;
-        maxEx = 0; minEx = 0; maxEy = 0; minEy = 0; maxHz = 0; minHz = 0;
-
-        //
-        // Map the main grid onto different areas, and assign each area to a different thread
-        //
-        interior.clear();
-        threadPool = new QThread*[settings.numberOfThreads];
-        for(int k=0; k<settings.numberOfThreads-1; k++) {               // Keep one thread for the boundary
-            interior.push_back(new Field(settings, &computation, &mutex, &threadCounter));
-            interior[k]->shallowCopyFields(field);
-        }
+void FDTD::on_resume_clicked()
+{
+    if(ui->start->isEnabled() && runMatchesSetup && simulation.canResume())
+    {
+        bool ok;
+        int extraSteps = QInputDialog::getInt(this, "Continue", "Number of additional steps:", simulation.completedSteps(), 1, 2147483647, 1, &ok);
+        if(!ok)
+            return;
 
-        for(int i=settings.PMLlayers; i<settings.cellsX+settings.PMLlayers; i++) {
-            for(int j=settings.PMLlayers; j<settings.cellsY+settings.PMLlayers; j++) {
-                bool assign = true;
-                for(int k=0; k<hsgSurfaces.size(); k++) {
-                    if(i >= hsgSurfaces[k].iMin - 1 &&
-                       i <= hsgSurfaces[k].iMax + 1 &&
-                       j >= hsgSurfaces[k].jMin - 1 &&
-                       j <= hsgSurfaces[k].jMax + 1)
-                        assign = false;
-                }
-                if(assign)
-                    interior[i%(settings.numberOfThreads-1)]->patch.push_back(Area(i, i+1, j, j+1));
-            }
-        }
+        ui->start->setEnabled(false);
+        ui->resume->setEnabled(false);
 
-        for(int k=0; k<hsgSurfaces.size(); k++) {
-            for(int i=hsgSurfaces[k].iMin - 1; i <= hsgSurfaces[k].iMax + 1; i++) {
-                for(int j=hsgSurfaces[k].jMin - 1; j <=hsgSurfaces[k].jMax + 1; j++)
-//                    if(i <= hsgSurfaces[k].iMin || i >= hsgSurfaces[k].iMax || j <= hsgSurfaces[k].jMin || j >= hsgSurfaces[k].jMax)
-                        interior[k%(settings.numberOfThreads-1)]->patch.push_back(Area(i, i+1, j, j+1));
-            }
-        }
+        int firstStep = simulation.completedSteps();
+        int steps = firstStep + extraSteps;
 
-        for(int k=0; k<settings.numberOfThreads-1; k++) {
-            threadPool[k] = new QThread;
-            interior[k]->computeDifferentials();            // Only on startup, compute dx and such
-            interior[k]->moveToThread(threadPool[k]);
-            connect(threadPool[k], SIGNAL(started()), interior[k], SLOT(updateFields()));
-            connect(interior[k], SIGNAL(fieldUpdateFinished(int)), this, SLOT(fieldUpdateFinished(int)));
-            connect(interior[k], SIGNAL(updateGUI(double, double, double, double, double, double)), this, SLOT(computationsAreDone(double, double, double, double, double, double)));
-            connect(interior[k], SIGNAL(finished()), threadPool[k], SLOT(quit()));
-            connect(interior[k], SIGNAL(finished()), interior[k], SLOT(deleteLater()));
-            connect(threadPool[k], SIGNAL(finished()), threadPool[k], SLOT(deleteLater()));
-            threadPool[k]->start();
-        }
+        simulation.resume(extraSteps, sensors);
 
-        //
-        // Finally, use the outer layer of the main grid for the boundary
-        //
-        boundary = new PMLBoundary(settings, &computation, &mutex, &threadCounter);
-        boundary->mapFields(field);     // Order is important here, because sizeWorkBuffer gets transferred here, which is needed hereafter
-        boundary->initBoundary();
-
-        int index = settings.numberOfThreads-1;
-        threadPool[index] = new QThread;
-        boundary->moveToThread(threadPool[index]);
-        connect(threadPool[index], SIGNAL(started()), boundary, SLOT(updateFields()));
-        connect(boundary, SIGNAL(fieldUpdateFinished(int)), this, SLOT(fieldUpdateFinished(int)));
-        connect(boundary, SIGNAL(updateGUI(double, double, double, double, double, double)), this, SLOT(computationsAreDone(double, double, double, double, double, double)));
-        connect(boundary, SIGNAL(finished()), threadPool[index], SLOT(quit()));
-        connect(boundary, SIGNAL(finished()), boundary, SLOT(deleteLater()));
-        connect(threadPool[index], SIGNAL(finished()), threadPool[index], SLOT(deleteLater()));
-        threadPool[index]->start();
+        ui->progressBar->setVisible(true);
+        ui->frameSlider->setVisible(false);
+        ui->progressBar->setMaximum(steps-1);
+        ui->progressBar->setValue(firstStep);
+        ui->frameSlider->setMaximum(std::ceil((double)field->settings.steps/field->settings.sampleDistance-1));
     }
 }
 
@@ -1160,24 +1201,20 @@ void FDTD::fieldUpdateFinished(int n)
     ui->progressBar->setValue(n);
 }
 
-void FDTD::computationsAreDone(double minEx, double maxEx, double minEy, double maxEy, double minHz, double maxHz) {
-    mutex.lock();
-    this->minEx = std::min(this->minEx, minEx);
-    this->maxEx = std::max(this->maxEx, maxEx);
-    this->minEy = std::min(this->minEy, minEy);
-    this->maxEy = std::max(this->maxEy, maxEy);
-    this->minHz = std::min(this->minHz, minHz);
-    this->maxHz = std::max(this->maxHz, maxHz);
-
-    threadCounter++;
-    if(threadCounter == field->settings.numberOfThreads)
-        showResults();
-
-    mutex.unlock();
+void FDTD::simulationFinished()
+{
+    minEx = simulation.minEx;
+    maxEx = simulation.maxEx;
+    minEy = simulation.minEy;
+    maxEy = simulation.maxEy;
+    minHz = simulation.minHz;
+    maxHz = simulation.maxHz;
+    showResults();
 }
 
 void FDTD::showResults() {
     ui->start->setEnabled(true);
+    ui->resume->setEnabled(runMatchesSetup);
     ui->progressBar->setVisible(false);
     ui->frameSlider->setVisible(true);
     setAxisRange();
@@ -1644,6 +1681,31 @@ void FDTD::drawStructures()
         item4->start->setCoords(hsgSurfaces[k].p[0].x, hsgSurfaces[k].p[1].y);
         item4->end->setCoords(hsgSurfaces[k].p[0].x, hsgSurfaces[k].p[0].y);
     }
+
+    pen = QPen(QColor(128,0,128), 2);      // Thicker purple, a sheet is not closed
+
+    settings.computeDifferentials();
+    double radius = std::min(settings.dx, settings.dy)/2;
+    for(int k=0; k<thin.size(); k++) {
+        if(thin[k].type == 'w' && thin[k].p.size() > 0) {
+            QCPItemEllipse *ellipse = new QCPItemEllipse(ui->customPlot);
+            ui->customPlot->addItem(ellipse);
+            ellipse->setAntialiased(true);
+            ellipse->setPen(pen);
+            ellipse->setBrush(QBrush(QColor(128, 0, 128)));
+            ellipse->topLeft->setCoords(thin[k].p[0].x-radius/2, thin[k].p[0].y+radius/2);
+            ellipse->bottomRight->setCoords(thin[k].p[0].x+radius/2, thin[k].p[0].y-radius/2);
+            continue;
+        }
+
+        for(int n=0; n+1<thin[k].p.size(); n++) {
+            QCPItemLine *item = new QCPItemLine(ui->customPlot);
+            ui->customPlot->addItem(item);
+            item->setPen(pen);
+            item->start->setCoords(thin[k].p[n].x, thin[k].p[n].y);
+            item->end->setCoords(thin[k].p[n+1].x, thin[k].p[n+1].y);
+        }
+    }
 }
 
 void FDTD::drawSources()
@@ -32,7 +32,10 @@
 #include "field.h"
 #include "pmlboundary.h"
 #include "materialdefinition.h"
+#include "materialindex.h"
 #include "materialsettings.h"
+#include "thindefinition.h"
+#include "thinsettings.h"
 #include "currentsource.h"
 #include "sourcesettings.h"
 #include "planewave.h"
@@ -40,9 +43,13 @@
 #include "sensordefinition.h"
 #include "sensorsettings.h"
 #include "sensorresult.h"
-#include "SGSettings.h"
-#include "SGInterface.h"
+#include "sgsettings.h"
+#include "sginterface.h"
 #include "inputrange.h"
+#include "resourceestimate.h"
+#include "subgridplacement.h"
+#include "simulation.h"
+#include "projectfile.h"
 
 class QCPColorMap;
 class QCPColorScale;
@@ -60,31 +67,31 @@ class FDTD : public QMainWindow
     Preferences *preferencesWindow = NULL;      // Pointer to the preferences window
     SourceSettings *sourceWindow = NULL;        // Pointer to a source window
     MaterialSettings *materialWindow = NULL;    // Pointer to a material window
+    ThinSettings *thinWindow = NULL;            // Pointer to the window of a thin sheet or wire
     TFSFSettings *TFSFWindow = NULL;            // Pointer to a total field/scattered field window
     SensorSettings *sensorWindow = NULL;        // Pointer to a sensor window
     SensorResult *sensorResult = NULL;          // Pointer to the result window of a sensor
     SGSettings *hsgWindow = NULL;               // Pointer to define the settings of the subgridded region
     Settings settings;                          // This stores the settings set in the preferences
-    Field *field=NULL;                          // The goal is to cut this into pieces and give every piece to another thread
-    std::vector<Field*> interior;               // This stores the cut up pieces of "field"
-    PMLBoundary *boundary=NULL;                 // Pointer to the boundary (currently PML is always single threaded)
+    Simulation simulation;                      // Runs the main grid, the boundary and the subgrids on a pool of threads
+    Field *field=NULL;                          // The grid of the last run, owned by simulation
     std::vector<currentSource> currentSources;  // This stores the sources defined in the source window
     std::vector<MaterialDefinition> materials;  // This stores the materials defined in the material window
+    MaterialIndex materialLookup;               // Finds the material under the mouse, rebuilt whenever materials changes
+    std::vector<ThinDefinition> thin;           // This stores the sheets and wires thinner than a cell
     std::vector<PlaneWave> TFSF;                // This stores the plane wave used in total field/scattered field
     std::vector<SensorDefinition> sensors;      // This stores the settings of the sensors
     std::vector<SGInterface> hsgSurfaces;
 
     double minEx=0, maxEx=0, minEy=0, maxEy=0, minHz=0, maxHz=0;
     double dx, dy, dt;              // Necessary to compute distances in the grid
-    int threadCounter;              // Used to synchronize threads
 
     std::vector<Point> points;      // Variable which holds the points during drawing
     int numberOfPoints=0;
     bool plotted = false;
+    bool runMatchesSetup = false;   // No object or setting changed since the last run was started, so it can be continued
     char type;                      // p: point, s: square, n: n-gon
 
-    QThread** threadPool;
-
 public:
     void showResults();             // After computation, run this function to visualize the result
     void drawGrid();
@@ -95,12 +102,14 @@ public:
     void drawSensors();
     void clearPlot();
     void setAxisRange();
+    void setupChanged();            // After an edit, the last run cannot be continued anymore
+    bool checkResources();          // Warn if the run does not fit in the memory budget, returns false to cancel
 
     explicit FDTD(QWidget *parent = 0);
     ~FDTD();
 
 public slots:
-    void computationsAreDone(double minEx, double maxEx, double minEy, double maxEy, double minHz, double maxHz);
+    void simulationFinished();
     void fieldUpdateFinished(int n);
     void preferencesClosed();
     void doubleClickedGraph(QMouseEvent *event);
@@ -110,11 +119,14 @@ public slots:
 
     void sourceSettingsOK(currentSource a);
     void materialSettingsOK(MaterialDefinition a);
+    void thinSettingsOk(ThinDefinition a);
     void TFSFSettingsOk(PlaneWave a);           // Total field scattered field = TFSF
     void SensorSettingsOk(SensorDefinition a);
     void hsgSettingsOk(SGInterface a);
 
     void graphClicked(QMouseEvent *event);
+    void graphHovered(QMouseEvent *event);      // Material under the mouse in the status bar
+    void graphSelected(QMouseEvent *event);     // Select the clicked material in the list
     void plotSquare(QMouseEvent *event);        // Plot the drawn square on customPlot
     void plotPoint(QMouseEvent *event);
     void plotPolygon(QMouseEvent *event);
@@ -133,7 +145,10 @@ private slots:
     void saveAsClicked();
     void openClicked();
     void exportClicked();
+    void estimateClicked();
+    void placeSubgridsClicked();                            // Propose subgrids around the structures the main grid does not resolve
     void on_start_clicked();                                // When clicking start
+    void on_resume_clicked();                               // Continue the last run for a number of steps
     void on_frameSlider_valueChanged(int timeIndex);        // When changing the frame
     void on_field_currentIndexChanged(int index);       // When viewing a different field
 
@@ -143,6 +158,9 @@ private slots:
     void materialAppend();
     void materialItemsSettings();
     void materialItemsDelete();
+    void thinAppend();
+    void thinItemsSettings();
+    void thinItemsDelete();
     void TFSFAppend();
     void TFSFItemsSettings();
     void TFSFItemsDelete();
@@ -162,13 +180,13 @@ private slots:
     void on_sensors_clicked();
 
 private:
-    QWaitCondition computation;
     QStandardItemModel *list;
     QStandardItem *sourceItem = new QStandardItem("Sources");
     QStandardItem *materialItem =  new QStandardItem("Material");
     QStandardItem *TFSFItem = new QStandardItem("Total field/scattered field");
     QStandardItem *sensorItem = new QStandardItem("Sensor");
     QStandardItem *hsgItem = new QStandardItem("Dispersive FDTD");
+    QStandardItem *thinItem = new QStandardItem("Thin sheets and wires");
     QMenu* sourcesContextMenu;
     QMenu* sourcesItemsContextMenu;
     QMenu* materialContextMenu;
@@ -179,7 +197,8 @@ private:
     QMenu* SensorItemsContextMenu;
     QMenu* hsgContextMenu;
     QMenu* hsgItemsContextMenu;
-    QMutex mutex;
+    QMenu* thinContextMenu;
+    QMenu* thinItemsContextMenu;
     QPen pen = QPen(QColor(128,0,128));
     Ui::FDTD *ui;
 
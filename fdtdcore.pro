@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Solver library without Qt, see engine.h for the entry point
+#
+#-------------------------------------------------
+
+TARGET = fdtdcore
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+
+include(solver.pri)
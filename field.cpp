@@ -22,46 +22,36 @@
 #define epsilon0    8.8541878176E-12
 #define mu0         1.2566370614E-6
 
-Field::Field(Settings settings, QWaitCondition *waitCondition, QMutex* mutex, int* threadCounter)
+Field::Field(Settings settings, ThreadSync *sync)
 {
     this->settings = settings;
-    this->computation = waitCondition;
-    this->mutex = mutex;
-    this->threadCounter = threadCounter;
+    this->sync = sync;
 }
 
 void Field::deleteFields()
 {
     if(WBEx != NULL) {
+        int nx = 2*settings.PMLlayers+settings.cellsX;
+        int ny = 2*settings.PMLlayers+settings.cellsY;
+
         for(int t=0; t<std::ceil((double)settings.steps/settings.sampleDistance); t++) {
-            for(int i=0; i<2*settings.PMLlayers+settings.cellsX; i++){
-                delete[] OBEx[t][i];
-                delete[] OBEy[t][i];
-                delete[] OBHz[t][i];
-            }
-            delete[] OBEx[t];
-            delete[] OBEy[t];
-            delete[] OBHz[t];
+            pool->release(OBEx[t], nx, ny);
+            pool->release(OBEy[t], nx, ny);
+            pool->release(OBHz[t], nx, ny);
         }
 
         for(int t=0; t<sizeWorkBuffer; t++) {
-            for(int i=0; i<2*settings.PMLlayers+settings.cellsX; i++){
-                delete[] WBEx[t][i];
-                delete[] WBEy[t][i];
-                delete[] WBHz[t][i];
-            }
-            delete[] WBEx[t];
-            delete[] WBEy[t];
-            delete[] WBHz[t];
+            pool->release(WBEx[t], nx, ny);
+            pool->release(WBEy[t], nx, ny);
+            pool->release(WBHz[t], nx, ny);
         }
 
-        for(int i=0; i<2*settings.PMLlayers+settings.cellsX; i++) {
-            delete[] sigmaR[i];
-            delete[] sigmaU[i];
-            delete[] epsR[i];
-            delete[] epsU[i];
-            delete[] muC[i];
-        }
+        pool->release(sigmaR, nx, ny);
+        pool->release(sigmaU, nx, ny);
+        pool->release(epsR, nx, ny);
+        pool->release(epsU, nx, ny);
+        pool->release(muC, nx, ny);
+        delete materialMap;
 
         delete[] OBEx;
         delete[] OBEy;
@@ -69,11 +59,6 @@ void Field::deleteFields()
         delete[] WBEx;
         delete[] WBEy;
         delete[] WBHz;
-        delete[] epsR;
-        delete[] epsU;
-        delete[] muC;
-        delete[] sigmaR;
-        delete[] sigmaU;
 
         OBEx = NULL;
         OBEy = NULL;
@@ -86,6 +71,7 @@ void Field::deleteFields()
         muC = NULL;
         sigmaR = NULL;
         sigmaU = NULL;
+        materialMap = NULL;
     }
 }
 
@@ -95,71 +81,67 @@ Field::~Field()
 
 void Field::initFields()
 {
-    OBEx = new double**[(int)std::ceil((double)settings.steps/settings.sampleDistance)];
-    OBEy = new double**[(int)std::ceil((double)settings.steps/settings.sampleDistance)];
-    OBHz = new double**[(int)std::ceil((double)settings.steps/settings.sampleDistance)];
+    int nx = 2*settings.PMLlayers+settings.cellsX;
+    int ny = 2*settings.PMLlayers+settings.cellsY;
+    int frames = std::ceil((double)settings.steps/settings.sampleDistance);
+
+    OBEx = new double**[frames];
+    OBEy = new double**[frames];
+    OBHz = new double**[frames];
 
     WBEx = new double**[sizeWorkBuffer];
     WBEy = new double**[sizeWorkBuffer];
     WBHz = new double**[sizeWorkBuffer];
 
-    epsR = new double*[2*settings.PMLlayers+settings.cellsX];
-    epsU = new double*[2*settings.PMLlayers+settings.cellsX];
-    muC = new double*[2*settings.PMLlayers+settings.cellsX];
-    sigmaR = new double*[2*settings.PMLlayers+settings.cellsX];
-    sigmaU = new double*[2*settings.PMLlayers+settings.cellsX];
-
-    for(int k=0; k<std::ceil((double)settings.steps/settings.sampleDistance); k++) {
-        OBEx[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-        OBEy[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-        OBHz[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-
-        for(int m=0; m<2*settings.PMLlayers+settings.cellsX; m++) {
-            OBEx[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-            OBEy[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-            OBHz[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-
-            for(int j=0; j<2*settings.PMLlayers+settings.cellsY; j++) {
-                OBEx[k][m][j] = 0;            // Initialize everything to 0, because WB swaps with OB using these values
-                OBEy[k][m][j] = 0;            // It'd suffice to initialize the boundary to zero, but this is easier coding :-)
-                OBHz[k][m][j] = 0;
-            }
-        }
+    for(int k=0; k<frames; k++) {
+        OBEx[k] = pool->allocate(nx, ny);       // Initialized to 0, because WB swaps with OB using these values
+        OBEy[k] = pool->allocate(nx, ny);       // It'd suffice to initialize the boundary to zero, but this is easier coding :-)
+        OBHz[k] = pool->allocate(nx, ny);
     }
 
     for(int k=0; k<sizeWorkBuffer; k++) {
-        WBEx[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-        WBEy[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-        WBHz[k] = new double*[2*settings.PMLlayers+settings.cellsX];
-
-        for(int m=0; m<2*settings.PMLlayers+settings.cellsX; m++) {
-            WBEx[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-            WBEy[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-            WBHz[k][m] = new double[2*settings.PMLlayers+settings.cellsY];
-
-            for(int j=0; j<2*settings.PMLlayers+settings.cellsY; j++) {
-                WBEx[k][m][j] = 0;            // Initialize everything to 0, because the boundary won't be updated in the FDTD routines
-                WBEy[k][m][j] = 0;            // It'd suffice to initialize the boundary to zero, but this is easier coding :-)
-                WBHz[k][m][j] = 0;
-            }
-        }
+        WBEx[k] = pool->allocate(nx, ny);       // Initialized to 0, because the boundary won't be updated in the FDTD routines
+        WBEy[k] = pool->allocate(nx, ny);
+        WBHz[k] = pool->allocate(nx, ny);
     }
 
-    for(int k=0; k<2*settings.PMLlayers+settings.cellsX; k++) {           // Epsilon and mu are not time dependent
-        epsR[k] = new double[2*settings.PMLlayers+settings.cellsY];
-        epsU[k] = new double[2*settings.PMLlayers+settings.cellsY];
-        muC[k] = new double[2*settings.PMLlayers+settings.cellsY];
-        sigmaR[k] = new double[2*settings.PMLlayers+settings.cellsY];
-        sigmaU[k] = new double[2*settings.PMLlayers+settings.cellsY];
-
-        for(int m=0; m<2*settings.PMLlayers+settings.cellsY; m++) {
-            epsR[k][m] = epsilon0;
-            epsU[k][m] = epsilon0;
-            muC[k][m] = mu0;
-            sigmaR[k][m] = 0;
-            sigmaU[k][m] = 0;
-        }
+    epsR = pool->allocate(nx, ny, epsilon0);    // Epsilon and mu are not time dependent
+    epsU = pool->allocate(nx, ny, epsilon0);
+    muC = pool->allocate(nx, ny, mu0);
+    sigmaR = pool->allocate(nx, ny);
+    sigmaU = pool->allocate(nx, ny);
+    materialMap = new MaterialMap();
+}
+
+void Field::extendFields(int steps)
+{
+    int oldFrames = std::ceil((double)settings.steps/settings.sampleDistance);
+    int newFrames = std::ceil((double)steps/settings.sampleDistance);
+
+    double ***newOBEx = new double**[newFrames];
+    double ***newOBEy = new double**[newFrames];
+    double ***newOBHz = new double**[newFrames];
+
+    for(int k=0; k<oldFrames; k++) {            // The frames which were already computed are only handed over
+        newOBEx[k] = OBEx[k];
+        newOBEy[k] = OBEy[k];
+        newOBHz[k] = OBHz[k];
+    }
+
+    for(int k=oldFrames; k<newFrames; k++) {
+        newOBEx[k] = pool->allocate(2*settings.PMLlayers+settings.cellsX, 2*settings.PMLlayers+settings.cellsY);     // Zero, same reason as in initFields
+        newOBEy[k] = pool->allocate(2*settings.PMLlayers+settings.cellsX, 2*settings.PMLlayers+settings.cellsY);
+        newOBHz[k] = pool->allocate(2*settings.PMLlayers+settings.cellsX, 2*settings.PMLlayers+settings.cellsY);
     }
+
+    delete[] OBEx;
+    delete[] OBEy;
+    delete[] OBHz;
+    OBEx = newOBEx;
+    OBEy = newOBEy;
+    OBHz = newOBHz;
+
+    settings.steps = steps;
 }
 
 void Field::computeDifferentials() {
@@ -179,31 +161,36 @@ void Field::transferSample(int n) {
 
 void Field::updateFields()
 {
-    for(int n=0; n<settings.steps; n++) {
+    const MaterialMap *map = materialMap != NULL && materialMap->compact ? materialMap : NULL;     // Else the parameters of every cell are read
+
+    for(int n=firstStep; n<settings.steps; n++) {
         int Old = (n-1+sizeWorkBuffer)%sizeWorkBuffer;      // Old time
         int New = n%sizeWorkBuffer;                         // New time
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads) {
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        }
-        else {
-            *threadCounter = 0;
+        sync->synchronize(settings.numberOfThreads, [&]{
             if(n%settings.sampleDistance == 0)
                 transferSample(n);        // Transfer sample from work buffer to output buffer
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        });
 
+        int next = 0;                       // The dispersive cells come in the same order as the patches
         for(int m=0; m<patch.size(); m++) {
            for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
                 for(int j=patch[m].jMin; j<patch[m].jMax; j++) {
-                    double C = sigmaU[i][j]*dt/(2*epsU[i][j]);      // Add 1 to the time index of Hz and 0.5 to that of Ex and Ey
-                    WBEx[New][i][j] = (1-C)/(1+C)*WBEx[Old][i][j] + dt/epsU[i][j]/(1+C)*((WBHz[Old][i][j+1]-WBHz[Old][i][j])/dy);      // Add 0.5 to the second index (j)
+                    double aU, bU, aR, bR;
+                    if(map != NULL) {
+                        const MaterialMap::Coefficients &u = map->table[map->idU[i*map->ny+j]], &r = map->table[map->idR[i*map->ny+j]];
+                        aU = u.a; bU = u.b;
+                        aR = r.a; bR = r.b;
+                    }
+                    else {
+                        double C = sigmaU[i][j]*dt/(2*epsU[i][j]);      // Add 1 to the time index of Hz and 0.5 to that of Ex and Ey
+                        aU = (1-C)/(1+C); bU = dt/epsU[i][j]/(1+C);
 
-                    C = sigmaR[i][j]*dt/(2*epsR[i][j]);
-                    WBEy[New][i][j] = (1-C)/(1+C)*WBEy[Old][i][j] - dt/epsR[i][j]/(1+C)*((WBHz[Old][i+1][j]-WBHz[Old][i][j])/dx);      // Add 0.5 to the first index (i)
+                        C = sigmaR[i][j]*dt/(2*epsR[i][j]);
+                        aR = (1-C)/(1+C); bR = dt/epsR[i][j]/(1+C);
+                    }
+                    WBEx[New][i][j] = aU*WBEx[Old][i][j] + bU*((WBHz[Old][i][j+1]-WBHz[Old][i][j])/dy);      // Add 0.5 to the second index (j)
+                    WBEy[New][i][j] = aR*WBEy[Old][i][j] - bR*((WBHz[Old][i+1][j]-WBHz[Old][i][j])/dx);      // Add 0.5 to the first index (i)
 
                     for(int k=0; k<TFSF.size(); k++) {
                         if(i == TFSF[k].i0-1 && j >= TFSF[k].j0 && j <= TFSF[k].j1) {                   // Left boundary
@@ -253,6 +240,12 @@ void Field::updateFields()
                }
            }
 
+           for(; next < (int)dispersion.cells.size() && dispersion.cells[next].patch == m; next++) {
+               Dispersion::Cell &cell = dispersion.cells[next];
+               double ***E = cell.component == 'x' ? WBEx : WBEy;
+               dispersion.update(cell, E[New][cell.i][cell.j], E[Old][cell.i][cell.j]);
+           }
+
            for(int k=0; k<sensors.size(); k++)
            {
                if(sensors[k].i >= patch[m].iMin && sensors[k].i < patch[m].iMax && sensors[k].j >= patch[m].jMin && sensors[k].j < patch[m].jMax)
@@ -263,29 +256,30 @@ void Field::updateFields()
            }
         }
 
+        for(int k=0; k<(int)surfaceImpedance.nodes.size(); k++) { // Its patch may be left out, but the E on a surface always advances
+            SurfaceImpedance::Node &node = surfaceImpedance.nodes[k];
+            double ***E = node.component == 'x' ? WBEx : WBEy;
+            E[New][node.i][node.j] = surfaceImpedance.advance(node, WBHz[Old][node.iH][node.jH]);
+        }
+
         for(int m=0; m<patch.size(); m++) {         // First evaluate the main grid
             for(int k=0; k<hsgSurfaces.size(); k++) {
                 if(hsgSurfaces[k].iMin >= patch[m].iMin && hsgSurfaces[k].iMin < patch[m].iMax &&
-                        hsgSurfaces[k].jMin >= patch[m].jMin && hsgSurfaces[k].jMin < patch[m].jMax)
+                        hsgSurfaces[k].jMin >= patch[m].jMin && hsgSurfaces[k].jMin < patch[m].jMax) {
                     hsgSurfaces[k].advanceE(n);    // Only update E if this is the responsible thread
+                    SGField *FB = hsgSurfaces[k].FB;
+                    sync->post([FB, n]{ FB->updateFields(n); });       // Any free thread may solve it, the main grid H does not need it
+                }
             }
         }
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads) {
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        }
-        else {
-            *threadCounter = 0;
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        sync->synchronize(settings.numberOfThreads);
 
         for(int m=0; m<patch.size(); m++) {
            for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
                 for(int j=patch[m].jMin; j<patch[m].jMax; j++) {
-                    WBHz[New][i][j] = WBHz[Old][i][j] + dt/muC[i][j]*((WBEx[New][i][j]-WBEx[New][i][j-1])/dy - (WBEy[New][i][j]-WBEy[New][i-1][j])/dx);  // Add 1 to the time index of Hz, O.5 to Ex and Ey
+                    double bC = map != NULL ? map->table[map->idC[i*map->ny+j]].b : dt/muC[i][j];
+                    WBHz[New][i][j] = WBHz[Old][i][j] + bC*((WBEx[New][i][j]-WBEx[New][i][j-1])/dy - (WBEy[New][i][j]-WBEy[New][i-1][j])/dx);  // Add 1 to the time index of Hz, O.5 to Ex and Ey
 
                     for(int k=0; k<TFSF.size(); k++) {
                         if(i == TFSF[k].i0 && j >= TFSF[k].j0 && j <= TFSF[k].j1) {                    // Left boundary
@@ -345,12 +339,13 @@ void Field::updateFields()
            }
         }
 
+        sync->finishTasks();                // Every subgrid is solved before its sensors are read and the step is finished
+
         for(int m=0; m<patch.size(); m++) { // First evaluate the main grid
             for(int k=0; k<hsgSurfaces.size(); k++) {
                 if(hsgSurfaces[k].iMin >= patch[m].iMin && hsgSurfaces[k].iMin < patch[m].iMax &&
                         hsgSurfaces[k].jMin >= patch[m].jMin && hsgSurfaces[k].jMin < patch[m].jMax) {
 
-                    hsgSurfaces[k].advanceH(n);    // Only update H if this is the responsible thread
                     for(int p=0; p<sensors.size(); p++) {
                         if(sensors[p].i >= hsgSurfaces[k].iMin && sensors[p].i < hsgSurfaces[k].iMax && sensors[p].j >= hsgSurfaces[k].jMin && sensors[p].j < hsgSurfaces[k].jMax) {
                             int i = fmax((sensors[p].xpos - hsgSurfaces[k].FB->bottomLeft.x)/(dx/hsgSurfaces[k].FB->xRatio) - hsgSurfaces[k].FB->xRatio + 1, 0);
@@ -364,23 +359,17 @@ void Field::updateFields()
             }
         }
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads) {
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        }
-        else {
-            *threadCounter = 0;
-            emit fieldUpdateFinished(n);
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        bool proceed = sync->synchronize(settings.numberOfThreads, [&]{
+            if(sync->stepFinished)
+                sync->stepFinished(n);
+        });
 
-        if(n > settings.steps-2) {
-            emit updateGUI(minEx, maxEx, minEy, maxEy, minHz, maxHz);
-            emit finished();
-        }
+        if(!proceed)
+            break;                  // Cancelled, every thread stops after the same step
     }
+
+    if(sync->threadFinished)
+        sync->threadFinished(minEx, maxEx, minEy, maxEy, minHz, maxHz);
 }
 
 void Field::shallowCopyFields(Field* a)
@@ -396,6 +385,8 @@ void Field::shallowCopyFields(Field* a)
     this->muC = a->muC;
     this->sigmaR = a->sigmaR;
     this->sigmaU = a->sigmaU;
+    this->materialMap = a->materialMap;
+    this->pool = a->pool;
     this->TFSF = a->TFSF;
     this->sensors = a->sensors;
     this->current = a->current;
@@ -415,90 +406,510 @@ void Field::defineSources(const std::vector<currentSource> current)
     }
 }
 
-void Field::defineMaterial(const std::vector<MaterialDefinition> &material)
+void Field::defineThin(const std::vector<ThinDefinition> &thin)
 {
     settings.computeDifferentials();
     dx = settings.dx;
     dy = settings.dy;
-    for(int k=0; k<material.size(); k++) {
-        pointInPolygon p;
-        std::vector<Point> points;      // To prevent out of scope
-        if(material[k].p.size() == 2)
-        {
-            points.push_back(Point(material[k].p[0].x, material[k].p[0].y));
-            points.push_back(Point(material[k].p[0].x, material[k].p[1].y));
-            points.push_back(Point(material[k].p[1].x, material[k].p[1].y));
-            points.push_back(Point(material[k].p[1].x, material[k].p[0].y));
-            p.vertices = &points;
+    auto I = [&](double x, double shiftX) { return x/dx - shiftX + settings.PMLlayers + settings.cellsX/2.0; };     // Cell i of the points shifted by shiftX covers i to i+1
+    auto J = [&](double y, double shiftY) { return y/dy - shiftY + settings.PMLlayers + settings.cellsY/2.0; };
+    auto inside = [&](int i, int j) {
+        return i >= settings.PMLlayers && i < settings.PMLlayers+settings.cellsX && j >= settings.PMLlayers && j < settings.PMLlayers+settings.cellsY;
+    };
+
+    for(int k=0; k<(int)thin.size(); k++) {
+        if(thin[k].type == 'w') {
+            // A conductor taking a fraction f of a cell, for small f it gives eps*(1+2f) to the E across it and mu*(1-f) to the Hz along it
+            if(thin[k].p.size() == 0)
+                continue;
+            double f = std::min(M_PI*thin[k].thickness*thin[k].thickness/(dx*dy), 0.25);
+            double x = thin[k].p[0].x, y = thin[k].p[0].y;
+            int i = floor(I(x, 0)), j = floor(J(y, 0));
+            if(inside(i, j))
+                muC[i][j] *= 1-f;
+            i = floor(I(x, 0.5));
+            if(inside(i, j))
+                epsR[i][j] *= 1+2*f;
+            i = floor(I(x, 0));
+            j = floor(J(y, 0.5));
+            if(inside(i, j))
+                epsU[i][j] *= 1+2*f;
+            continue;
         }
-        else
-            p.vertices = &material[k].p;
-
-        for(int i=settings.PMLlayers; i<settings.PMLlayers+settings.cellsX; i++) {
-            for(int j=settings.PMLlayers; j<settings.PMLlayers+settings.cellsY; j++) {
-                if(p.inPolygon((i-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx, (j-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy))
-                {
-                    muC[i][j] = material[k].mur*mu0;
+
+        // A sheet of length l in a cell gives it sigma*thickness*l/(dx*dy), and eps likewise, for Ex and Ey alike
+        // Only the E along the sheet should drive a current, but that needs the terms of the tensor that mix Ex and Ey, which the staggered
+        // grid does not have, weighting Ex and Ey by the direction of the sheet instead makes a tilted sheet leak
+        for(int n=0; n+1<(int)thin[k].p.size(); n++) {
+            const Point &a = thin[k].p[n], &b = thin[k].p[n+1];
+            double length = hypot(b.x-a.x, b.y-a.y);
+            if(length == 0)
+                continue;
+
+            for(int m=0; m<2; m++) {        // Ex, then Ey
+                double shiftX = m == 0 ? 0 : 0.5, shiftY = m == 0 ? 0.5 : 0;
+                double **eps = m == 0 ? epsU : epsR, **sigma = m == 0 ? sigmaU : sigmaR;
+                double u0 = I(a.x, shiftX), u1 = I(b.x, shiftX), v0 = J(a.y, shiftY), v1 = J(b.y, shiftY);
+
+                // Cut the segment where it crosses the edges of the cells, every piece lies in the cell of its middle
+                std::vector<double> t = {0, 1};
+                for(int g=ceil(std::min(u0, u1)); u1 != u0 && g<=floor(std::max(u0, u1)); g++)
+                    t.push_back((g-u0)/(u1-u0));
+                for(int g=ceil(std::min(v0, v1)); v1 != v0 && g<=floor(std::max(v0, v1)); g++)
+                    t.push_back((g-v0)/(v1-v0));
+                std::sort(t.begin(), t.end());
+
+                for(int q=0; q+1<(int)t.size(); q++) {
+                    double middle = (t[q]+t[q+1])/2;
+                    int i = floor(u0+middle*(u1-u0)), j = floor(v0+middle*(v1-v0));
+                    if(t[q+1] <= t[q] || !inside(i, j))
+                        continue;
+
+                    double share = (t[q+1]-t[q])*length*thin[k].thickness/(dx*dy);
+                    eps[i][j] += (thin[k].epsr-1)*epsilon0*share;
+                    sigma[i][j] += thin[k].sigma*share;
                 }
+            }
+        }
+    }
+}
 
-                if(p.inPolygon((i+0.5-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx, (j-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy))
-                {
-                    epsR[i][j] = material[k].epsr*epsilon0;
-                    sigmaR[i][j] = material[k].sigma;
+void Field::findSurfaceImpedance(const MaterialIndex &index)
+{
+    surfaceImpedance.fits.clear();
+    surfaceImpedance.nodes.clear();
+    surfaceImpedance.psi.clear();
+    bool impedance = false;
+    for(int k=0; k<(int)index.materials->size(); k++) {   // Fitted from the length of the run up to the highest frequency of the grid
+        surfaceImpedance.fits.push_back((*index.materials)[k].SIBC == true ? SurfaceImpedance::fit((*index.materials)[k], dt, 2*M_PI/(settings.steps*dt), M_PI/dt) : SurfaceImpedance::Fit());
+        impedance = impedance || (*index.materials)[k].SIBC == true;
+    }
+    if(!impedance)
+        return;
+
+    auto X = [&](double i) { return (i-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx; };      // Same points as rasterise
+    auto Y = [&](double j) { return (j-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy; };
+    auto conductor = [&](int i, int j) {          // The Hz never changes, as in maskConductors
+        return std::isinf(epsU[i][j]) && std::isinf(epsR[i][j]) && std::isinf(epsU[i][j-1]) && std::isinf(epsR[i-1][j]);
+    };
+
+    // An E in the conductor with a Hz on one side of it that changes and one that does not lies on the surface, E = Zs*Hz gives it from the first
+    // The sign makes the power flow into the conductor, an E in a layer of a single cell stays at zero
+    for(int m=0; m<(int)patch.size(); m++) {
+        for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
+            for(int j=patch[m].jMin; j<patch[m].jMax; j++) {
+                for(int n=0; n<2; n++) {
+                    char component = n == 0 ? 'x' : 'y';
+                    double eps = n == 0 ? epsU[i][j] : epsR[i][j];
+                    double x = i+0.5*n, y = j+0.5*(1-n);
+                    int k = index.materialAt(X(x), Y(y));
+                    if(!std::isinf(eps) || k < 0 || (*index.materials)[k].SIBC == false)
+                        continue;
+
+                    int iNext = i+n, jNext = j+1-n;       // The Hz on the other side, the first one is Hz[i][j]
+                    bool low = conductor(i, j), high = conductor(iNext, jNext);
+                    if(low == high)
+                        continue;
+
+                    SurfaceImpedance::Node node = {i, j, component, low ? iNext : i, low ? jNext : j, 0, k, (int)surfaceImpedance.psi.size()};
+                    node.sign = (n == 0) == low ? 1 : -1;
+                    surfaceImpedance.nodes.push_back(node);
+                    surfaceImpedance.psi.resize(surfaceImpedance.psi.size() + surfaceImpedance.fits[k].p.size(), 0);
                 }
+            }
+        }
+    }
+}
+
+void Field::maskConductors()
+{
+    // A patch whose Ex and Ey lie in a conductor, as do the other two E around its Hz, never changes, so it is left out
+    // The patch that advances a subgrid stays
+    std::vector<Area> kept;
+    for(int m=0; m<(int)patch.size(); m++) {
+        bool conductor = true;
+        for(int i=patch[m].iMin; i<patch[m].iMax; i++)
+            for(int j=patch[m].jMin; j<patch[m].jMax; j++)
+                conductor = conductor && std::isinf(epsU[i][j]) && std::isinf(epsR[i][j]) && std::isinf(epsU[i][j-1]) && std::isinf(epsR[i-1][j]);
+
+        for(int k=0; k<(int)hsgSurfaces.size(); k++) {
+            if(hsgSurfaces[k].iMin >= patch[m].iMin && hsgSurfaces[k].iMin < patch[m].iMax &&
+                    hsgSurfaces[k].jMin >= patch[m].jMin && hsgSurfaces[k].jMin < patch[m].jMax)
+                conductor = false;
+        }
 
-                if(p.inPolygon((i-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx, (j+0.5-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy))
-                {
-                    epsU[i][j] = material[k].epsr*epsilon0;
-                    sigmaU[i][j] = material[k].sigma;
+        if(!conductor)
+            kept.push_back(patch[m]);
+    }
+    patch = kept;
+}
+
+void Field::findDispersive(const MaterialIndex &index)
+{
+    dispersion.cells.clear();
+    dispersion.poles.clear();
+    dispersion.dt = dt;
+    bool dispersive = false;
+    for(int k=0; k<(int)index.materials->size(); k++) {
+        dispersion.poles.push_back(Dispersion::pole((*index.materials)[k], dt));
+        dispersive = dispersive || (*index.materials)[k].dispersion != 0;
+    }
+    if(!dispersive)
+        return;
+
+    for(int m=0; m<(int)patch.size(); m++) {
+        for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
+            for(int j=patch[m].jMin; j<patch[m].jMax; j++) {
+                for(int n=0; n<2; n++) {
+                    char component = n == 0 ? 'x' : 'y';
+                    double x = (i+0.5*n-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx;       // Same points as rasterise
+                    double y = (j+0.5*(1-n)-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy;
+                    int k = index.materialAt(x, y);
+                    if(k < 0 || (*index.materials)[k].dispersion == 0 || (*index.materials)[k].PEC == true || (*index.materials)[k].SIBC == true)
+                        continue;
+
+                    // E at n+1 also drives the current, which takes the form of a larger eps and sigma
+                    double **eps = n == 0 ? epsU : epsR, **sigma = n == 0 ? sigmaU : sigmaR;
+                    eps[i][j] += dispersion.poles[k].g*dt/4;
+                    sigma[i][j] += dispersion.poles[k].g/2;
+
+                    double C = sigma[i][j]*dt/(2*eps[i][j]);
+                    Dispersion::Cell cell = {m, i, j, component, k, dt/eps[i][j]/(1+C), 0, 0};
+                    dispersion.cells.push_back(cell);
                 }
             }
         }
+    }
+}
 
-        if(material[k].YuMittra == true)        // Do this after the initialization of epsilon, mu and sigma
-        {
-            for(int i=settings.PMLlayers; i<settings.PMLlayers+settings.cellsX; i++) {
-                for(int j=settings.PMLlayers; j<settings.PMLlayers+settings.cellsY; j++) {
-                    double distanceX = p.distanceX((i+0.5-settings.PMLlayers)*dx - settings.sizeX/2.0, (j+0.5-settings.PMLlayers-settings.cellsY/2.0)*dy);     // Compute the x distance between the given point and the closest edge
-                    double distanceY = p.distanceY((i+0.5-settings.PMLlayers-settings.cellsX/2.0)*dx, (j+0.5-settings.PMLlayers)*dy - settings.sizeY/2.0);     // Compute the x distance between the given point and the closest edge
-
-                    if(std::abs(distanceX) < dx) {   // We're on the boundary
-                        double distance1 = std::abs(distanceX);
-                        double distance2 = dx - distance1;
-
-                        if(distanceX > 0) {     // Left side
-                            if(distance1 <= dx/2)
-                                epsU[i+1][j] = (distance1*epsU[i][j] + distance2*epsU[i+1][j])/dx;
-                            else
-                                epsU[i+1][j] = (distance1*epsU[i+1][j] + distance2*epsU[i+2][j])/dx;
-                        }
-                        else {                  // Right side
-                            if(distance1 < dx/2)
-                                epsU[i][j] = (distance2*epsU[i][j] + distance1*epsU[i+1][j])/dx;
-                            else
-                                epsU[i][j] = (distance2*epsU[i-1][j] + distance1*epsU[i][j])/dx;
-                        }
-                    }
+void Field::compactMaterials()
+{
+    settings.computeDifferentials();            // Same dt as computeDifferentials
+    materialMap->build(epsU, sigmaU, epsR, sigmaR, muC, 2*settings.PMLlayers+settings.cellsX, 2*settings.PMLlayers+settings.cellsY, settings.dt);
+}
+
+void Field::rasterise(pointInPolygon &p, double shiftX, double shiftY, double **a, double valueA, double **b, double valueB, int jFirst, int jLast)
+{
+    int iFirst = settings.PMLlayers, iLast = settings.PMLlayers+settings.cellsX-1;
+    auto X = [&](int i) { return (i+shiftX-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx; };     // The point of cell (i, j)
+    auto Y = [&](int j) { return (j+shiftY-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy; };
+
+    // Only the rows of the band that cross the polygon
+    double yMin = (*p.vertices)[0].y, yMax = (*p.vertices)[0].y;
+    for(int k=1; k<(int)p.vertices->size(); k++) {
+        yMin = std::min(yMin, (*p.vertices)[k].y);
+        yMax = std::max(yMax, (*p.vertices)[k].y);
+    }
+    double below = floor((yMin - Y(0))/dy) - 1, above = ceil((yMax - Y(0))/dy) + 1;
+    if(below > jFirst)
+        jFirst = below > jLast ? jLast+1 : (int)below;
+    if(above < jLast)
+        jLast = above < jFirst ? jFirst-1 : (int)above;
+
+    std::vector<double> crossing;
+    for(int j=jFirst; j<=jLast; j++) {
+        p.crossings(Y(j), crossing);
+        for(int m=0; m+1<(int)crossing.size(); m+=2) {     // The points from crossing[m] up to crossing[m+1] are inside
+            double first = ceil((crossing[m] - X(0))/dx);
+            int i = first < iFirst ? iFirst : first > iLast ? iLast+1 : (int)first;
+            while(i > iFirst && X(i-1) >= crossing[m])      // Round-off in the estimate, the test is the same as in inPolygon
+                i--;
+            while(i <= iLast && X(i) < crossing[m])
+                i++;
+
+            for(; i<=iLast && X(i) < crossing[m+1]; i++) {
+                a[i][j] = valueA;
+                if(b != NULL)
+                    b[i][j] = valueB;
+            }
+        }
+    }
+}
 
-                    if(std::abs(distanceY) < dy) {
-                        double distance1 = std::abs(distanceY);
-                        double distance2 = dy - distance1;
+void Field::rasteriseRows(const MaterialIndex &index, const std::vector<int> &group, int jFirst, int jLast)
+{
+    for(int n=0; n<(int)group.size(); n++) {
+        int k = group[n];
+        const MaterialDefinition &material = (*index.materials)[k];
+        pointInPolygon p;
+        p.vertices = &index.polygons[k];
 
-                        if(distanceY < 0) {     // Top
-                            if(distance1 < dy/2)
-                                epsR[i][j] = (distance2*epsR[i][j] + distance1*epsR[i][j+1])/dy;
-                            else
-                                epsR[i][j] = (distance2*epsR[i][j-1] + distance1*epsR[i][j])/dy;
-                        }
-                        else {                  // Bottom
-                            if(distance1 <= dy/2)
-                                epsR[i][j+1] = (distance1*epsR[i][j] + distance2*epsR[i][j+1])/dy;
-                            else
-                                epsR[i][j+1] = (distance1*epsR[i][j+1] + distance2*epsR[i][j+2])/dy;
-                        }
-                    }
+        if(material.PEC == true || material.SIBC == true) {     // An infinite eps keeps E at zero, a = 1 and b = 0 in the update
+            rasterise(p, 0, 0, muC, material.mur*mu0, NULL, 0, jFirst, jLast);
+            rasterise(p, 0.5, 0, epsR, INFINITY, sigmaR, 0, jFirst, jLast);
+            rasterise(p, 0, 0.5, epsU, INFINITY, sigmaU, 0, jFirst, jLast);
+            continue;
+        }
+
+        if(material.areaFraction == true) {
+            areaFraction(p, 0, 0, 'z', muC, material.mur*mu0, NULL, 0, jFirst, jLast);
+            areaFraction(p, 0.5, 0, 'y', epsR, material.epsr*epsilon0, sigmaR, material.sigma, jFirst, jLast);
+            areaFraction(p, 0, 0.5, 'x', epsU, material.epsr*epsilon0, sigmaU, material.sigma, jFirst, jLast);
+            continue;
+        }
+
+        rasterise(p, 0, 0, muC, material.mur*mu0, NULL, 0, jFirst, jLast);                            // Hz
+        rasterise(p, 0.5, 0, epsR, material.epsr*epsilon0, sigmaR, material.sigma, jFirst, jLast);     // Ey
+        rasterise(p, 0, 0.5, epsU, material.epsr*epsilon0, sigmaU, material.sigma, jFirst, jLast);     // Ex
+    }
+}
+
+void Field::areaFraction(pointInPolygon &p, double shiftX, double shiftY, char component, double **a, double valueA, double **b, double valueB, int jFirst, int jLast)
+{
+    int iFirst = settings.PMLlayers, iLast = settings.PMLlayers+settings.cellsX-1;
+    auto X = [&](int i) { return (i+shiftX-settings.PMLlayers-settings.cellsX/2.0+0.5)*dx; };     // The point of cell (i, j), the middle of the area it stands for
+    auto Y = [&](int j) { return (j+shiftY-settings.PMLlayers-settings.cellsY/2.0+0.5)*dy; };
+
+    double yMin = (*p.vertices)[0].y, yMax = (*p.vertices)[0].y;
+    for(int k=1; k<(int)p.vertices->size(); k++) {
+        yMin = std::min(yMin, (*p.vertices)[k].y);
+        yMax = std::max(yMax, (*p.vertices)[k].y);
+    }
+    double below = floor((yMin - Y(0))/dy) - 1, above = ceil((yMax - Y(0))/dy) + 1;
+    if(below > jFirst)
+        jFirst = below > jLast ? jLast+1 : (int)below;
+    if(above < jLast)
+        jLast = above < jFirst ? jFirst-1 : (int)above;
+
+    std::vector<Point> strip, cell;
+    std::vector<int> cells;
+    std::vector<double> oldA, oldB;
+    for(int j=jFirst; j<=jLast; j++) {
+        double yLow = Y(j) - dy/2, yHigh = Y(j) + dy/2;
+        pointInPolygon::clip(*p.vertices, 'y', yLow, yHigh, strip);
+        if(strip.size() < 3)
+            continue;
+
+        // Only the cells an edge goes through are partly filled, the others are filled as without averaging
+        cells.clear();
+        for(int m=0; m<(int)strip.size(); m++) {
+            const Point &u = strip[m], &v = strip[(m+1)%strip.size()];
+            if((u.y == yLow && v.y == yLow) || (u.y == yHigh && v.y == yHigh))
+                continue;
+
+            double first = std::max(floor((std::min(u.x, v.x) - X(0))/dx + 0.5), (double)iFirst);
+            double last = std::min(floor((std::max(u.x, v.x) - X(0))/dx + 0.5), (double)iLast);
+            for(int i=first; i<=last; i++)
+                cells.push_back(i);
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        oldA.resize(cells.size());
+        oldB.resize(cells.size());
+        for(int m=0; m<(int)cells.size(); m++) {
+            oldA[m] = a[cells[m]][j];
+            oldB[m] = b != NULL ? b[cells[m]][j] : 0;
+        }
+
+        rasterise(p, shiftX, shiftY, a, valueA, b, valueB, j, j);
+
+        for(int m=0; m<(int)cells.size(); m++) {
+            int i = cells[m];
+            if(std::isinf(oldA[m]))             // Against a conductor the boundary stays a staircase
+                continue;
+
+            double xLow = X(i) - dx/2, xHigh = X(i) + dx/2, nx, ny;
+            pointInPolygon::clip(strip, 'x', xLow, xHigh, cell);
+            double fraction = std::min(pointInPolygon::area(cell, xLow, xHigh, yLow, yHigh, nx, ny)/(dx*dy), 1.0);
+
+            // Parallel to the boundary the field sees the mean, across it the harmonic mean, a component lies along the normal by weight
+            double normal = nx*nx + ny*ny, weight = 0;
+            if(normal > 0 && component != 'z')
+                weight = (component == 'x' ? nx*nx : ny*ny)/normal;
+
+            double mean = fraction*valueA + (1-fraction)*oldA[m];
+            double harmonic = fraction/valueA + (1-fraction)/oldA[m];
+            a[i][j] = 1/(weight*harmonic + (1-weight)/mean);
+            if(b != NULL)
+                b[i][j] = fraction*valueB + (1-fraction)*oldB[m];
+        }
+    }
+}
+
+void Field::lineCrossings(const std::vector<Point> &polygon, int first, int last, double offset, double d, std::vector<int> &start, std::vector<double> &crossing)
+{
+    int lines = last-first+1;
+    start.assign(lines+1, 0);
+    crossing.clear();
+    if(lines <= 0)
+        return;
+
+    std::vector<int> fill;
+    for(int pass=0; pass<2; pass++) {           // Count, then fill, the lines an edge crosses follow from its end points
+        int i, j, nvert=polygon.size();
+        for (i = 0, j = nvert-1; i < nvert; j = i++) {
+            const Point &a = polygon[i], &b = polygon[j];
+            double below = floor(std::min(a.y, b.y)/d - offset) - 1, above = ceil(std::max(a.y, b.y)/d - offset) + 1;
+            int kFirst = below > first ? (below > last ? last+1 : (int)below) : first;
+            int kLast = above < last ? (above < first ? first-1 : (int)above) : last;
+
+            for(int k=kFirst; k<=kLast; k++) {
+                double y = (k+offset)*d;
+                if ((a.y>y) != (b.y>y)) {               // Same test and expression as in pointInPolygon
+                    if(pass == 0)
+                        start[k-first+1]++;
+                    else
+                        crossing[fill[k-first]++] = (b.x-a.x) * (y-a.y) / (b.y-a.y) + a.x;
                 }
             }
         }
+
+        if(pass == 0) {
+            for(int k=0; k<lines; k++)
+                start[k+1] += start[k];
+            crossing.resize(start[lines]);
+            fill = start;
+        }
     }
 }
+
+void Field::yuMittraRows(const std::vector<Point> &polygon, int jFirst, int jLast)
+{
+    // Only the cells within a cell of where an edge crosses the row can change, they are done in the same order as before
+    std::vector<int> start, cells;
+    std::vector<double> crossing;
+    lineCrossings(polygon, jFirst, jLast, 0.5-settings.PMLlayers-settings.cellsY/2.0, dy, start, crossing);
+
+    for(int j=jFirst; j<=jLast; j++) {
+        const double *line = crossing.data() + start[j-jFirst];
+        int n = start[j-jFirst+1] - start[j-jFirst];
+
+        cells.clear();
+        for(int m=0; m<n; m++) {
+            double t = (line[m] + settings.sizeX/2.0)/dx - 0.5 + settings.PMLlayers;
+            for(int i=std::max(floor(t)-1, (double)settings.PMLlayers); i<=std::min(ceil(t)+1, settings.PMLlayers+settings.cellsX-1.0); i++)
+                cells.push_back(i);
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        for(int m=0; m<(int)cells.size(); m++) {
+            int i = cells[m];
+            double distanceX = pointInPolygon::nearestExterior(line, n, (i+0.5-settings.PMLlayers)*dx - settings.sizeX/2.0);      // The x distance between the given point and the closest edge
+
+            if(std::isinf(epsU[i-1][j] + epsU[i][j] + epsU[i+1][j] + epsU[i+2][j]))      // Next to a conductor, which is not averaged
+                continue;
+
+            if(std::abs(distanceX) < dx) {   // We're on the boundary
+                double distance1 = std::abs(distanceX);
+                double distance2 = dx - distance1;
+
+                if(distanceX > 0) {     // Left side
+                    if(distance1 <= dx/2)
+                        epsU[i+1][j] = (distance1*epsU[i][j] + distance2*epsU[i+1][j])/dx;
+                    else
+                        epsU[i+1][j] = (distance1*epsU[i+1][j] + distance2*epsU[i+2][j])/dx;
+                }
+                else {                  // Right side
+                    if(distance1 < dx/2)
+                        epsU[i][j] = (distance2*epsU[i][j] + distance1*epsU[i+1][j])/dx;
+                    else
+                        epsU[i][j] = (distance2*epsU[i-1][j] + distance1*epsU[i][j])/dx;
+                }
+            }
+        }
+    }
+}
+
+void Field::yuMittraColumns(const std::vector<Point> &polygon, int iFirst, int iLast)
+{
+    std::vector<Point> transposed;          // The columns of the polygon are the rows of its mirror image
+    for(int k=0; k<(int)polygon.size(); k++)
+        transposed.push_back(Point(polygon[k].y, polygon[k].x));
+
+    std::vector<int> start, cells;
+    std::vector<double> crossing;
+    lineCrossings(transposed, iFirst, iLast, 0.5-settings.PMLlayers-settings.cellsX/2.0, dx, start, crossing);
+
+    for(int i=iFirst; i<=iLast; i++) {
+        const double *line = crossing.data() + start[i-iFirst];
+        int n = start[i-iFirst+1] - start[i-iFirst];
+
+        cells.clear();
+        for(int m=0; m<n; m++) {
+            double t = (line[m] + settings.sizeY/2.0)/dy - 0.5 + settings.PMLlayers;
+            for(int j=std::max(floor(t)-1, (double)settings.PMLlayers); j<=std::min(ceil(t)+1, settings.PMLlayers+settings.cellsY-1.0); j++)
+                cells.push_back(j);
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        for(int m=0; m<(int)cells.size(); m++) {
+            int j = cells[m];
+            double distanceY = pointInPolygon::nearestExterior(line, n, (j+0.5-settings.PMLlayers)*dy - settings.sizeY/2.0);     // The y distance between the given point and the closest edge
+
+            if(std::isinf(epsR[i][j-1] + epsR[i][j] + epsR[i][j+1] + epsR[i][j+2]))
+                continue;
+
+            if(std::abs(distanceY) < dy) {
+                double distance1 = std::abs(distanceY);
+                double distance2 = dy - distance1;
+
+                if(distanceY < 0) {     // Top
+                    if(distance1 < dy/2)
+                        epsR[i][j] = (distance2*epsR[i][j] + distance1*epsR[i][j+1])/dy;
+                    else
+                        epsR[i][j] = (distance2*epsR[i][j-1] + distance1*epsR[i][j])/dy;
+                }
+                else {                  // Bottom
+                    if(distance1 <= dy/2)
+                        epsR[i][j+1] = (distance1*epsR[i][j] + distance2*epsR[i][j+1])/dy;
+                    else
+                        epsR[i][j+1] = (distance1*epsR[i][j+1] + distance2*epsR[i][j+2])/dy;
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::vector<std::function<void()> > > Field::materialStages(const MaterialIndex &index, int bands)
+{
+    settings.computeDifferentials();
+    dx = settings.dx;
+    dy = settings.dy;
+    bands = std::max(1, std::min(bands, std::min(settings.cellsX, settings.cellsY)));
+
+    std::vector<int> inside;            // The materials that reach into the interior
+    index.query(-settings.sizeX/2.0-dx, -settings.sizeY/2.0-dy, settings.sizeX/2.0+dx, settings.sizeY/2.0+dy, inside);
+
+    // Every band only writes its own rows, and does the materials in order, so later materials still win
+    // A Yu-Mittra material reads the neighbours of a cell, so it ends a group, after which its averaging gets a stage of its own
+    // Area fraction averaging only reads the cell it writes, so it stays in the group
+    std::vector<std::vector<std::function<void()> > > stages;
+    std::vector<int> group;
+    for(int n=0; n<(int)inside.size(); n++) {
+        int k = inside[n];
+        group.push_back(k);
+        bool yuMittra = (*index.materials)[k].YuMittra == true && (*index.materials)[k].areaFraction == false && (*index.materials)[k].PEC == false && (*index.materials)[k].SIBC == false;
+        if(!yuMittra && n < (int)inside.size()-1)
+            continue;
+
+        stages.push_back(std::vector<std::function<void()> >());
+        for(int b=0; b<bands; b++) {
+            int jFirst = settings.PMLlayers + b*settings.cellsY/bands, jLast = settings.PMLlayers + (b+1)*settings.cellsY/bands - 1;
+            stages.back().push_back([this, &index, group, jFirst, jLast] { rasteriseRows(index, group, jFirst, jLast); });
+        }
+        group.clear();
+
+        if(yuMittra) {                  // epsU only depends on its own row and epsR on its own column
+            const std::vector<Point> *polygon = &index.polygons[k];
+            stages.push_back(std::vector<std::function<void()> >());
+            for(int b=0; b<bands; b++) {
+                int jFirst = settings.PMLlayers + b*settings.cellsY/bands, jLast = settings.PMLlayers + (b+1)*settings.cellsY/bands - 1;
+                int iFirst = settings.PMLlayers + b*settings.cellsX/bands, iLast = settings.PMLlayers + (b+1)*settings.cellsX/bands - 1;
+                stages.back().push_back([this, polygon, jFirst, jLast] { yuMittraRows(*polygon, jFirst, jLast); });
+                stages.back().push_back([this, polygon, iFirst, iLast] { yuMittraColumns(*polygon, iFirst, iLast); });
+            }
+        }
+    }
+    return stages;
+}
+
+void Field::defineMaterial(const MaterialIndex &index)
+{
+    std::vector<std::vector<std::function<void()> > > stages = materialStages(index, 1);
+    for(int s=0; s<(int)stages.size(); s++)
+        for(int t=0; t<(int)stages[s].size(); t++)
+            stages[s][t]();
+}
@@ -24,31 +24,38 @@
 #include "math.h"
 #include "currentsource.h"
 #include "materialdefinition.h"
+#include "materialindex.h"
+#include "thindefinition.h"
+#include "materialmap.h"
+#include "dispersion.h"
+#include "surfaceimpedance.h"
 #include "planewave.h"
 #include "sensordefinition.h"
-#include "SGInterface.h"
+#include "sginterface.h"
 #include "pointinpolygon.h"
+#include "gridpool.h"
+#include "threadsync.h"
 #include <vector>
-#include <QObject>
-#include <QThread>
-#include <QWaitCondition>
 #include <cmath>
-#include <qdebug.h>
-#include <vector>
 #include <algorithm>
+#include <functional>
 
 class SGInterface;
 
-class Field : public QObject
+class Field
 {
-    Q_OBJECT
 public:
     double ***WBEx=NULL, ***WBEy=NULL, ***WBHz=NULL, **epsR=NULL, **epsU=NULL;      // WB = workbuffer
     double ***OBEx=NULL, ***OBEy=NULL, ***OBHz=NULL;                                // OB = output buffer
     double **muC=NULL, **sigmaR=NULL, **sigmaU=NULL;
-    int *threadCounter;
+    MaterialMap *materialMap=NULL;      // What the update reads instead of the parameters above, if compact
+    Dispersion dispersion;              // The dispersive cells of the patches of this piece, not shared
+    SurfaceImpedance surfaceImpedance;  // The E on the surface of the conductors with a surface impedance, of this piece
+    ThreadSync *sync;                   // Shared by every thread working on this grid
+    GridPool *pool=NULL;                // Every grid shaped array is taken from and returned to this pool
     double minEx=0, maxEx=0, minEy=0, maxEy=0, minHz=0, maxHz=0;
     int sizeWorkBuffer=4;
+    int firstStep=0;                    // Step at which updateFields starts, non-zero when continuing a finished run
     double dx, dy, dt;
 
     std::vector<Area> patch;
@@ -58,28 +65,30 @@ public:
     std::vector<SGInterface> hsgSurfaces;
     Settings settings;
 
-    Field(Settings settings, QWaitCondition *waitCondition, QMutex* mutex, int* threadCounter);
+    Field(Settings settings, ThreadSync *sync);
     ~Field();
     void initFields();
     void deleteFields();
+    void extendFields(int steps);       // Grow the output buffer to hold the frames up to steps, keeping the computed ones
 
     void transferSample(int n);
     void computeDifferentials();
     void shallowCopyFields(Field *a);
     void defineSources(const std::vector<currentSource> current);
-    void defineMaterial(const std::vector<MaterialDefinition> &material);
-
-private:
-    QMutex *mutex;
-    QWaitCondition* computation;
-
-public slots:
-    void updateFields();
-
-signals:
-    void finished();
-    void updateGUI(double, double, double, double, double, double);
-    void fieldUpdateFinished(int n);
+    void defineMaterial(const MaterialIndex &index);
+    std::vector<std::vector<std::function<void()> > > materialStages(const MaterialIndex &index, int bands);   // defineMaterial as stages of tasks that can run at the same time, index has to outlive them
+    void defineThin(const std::vector<ThinDefinition> &thin);   // Add the sheets and wires to the parameters of the cells they go through, after the materials
+    void findSurfaceImpedance(const MaterialIndex &index);  // List the E on the surface of the conductors with a surface impedance, before maskConductors
+    void maskConductors();              // Drop the patches inside a PEC, once the materials are final
+    void findDispersive(const MaterialIndex &index);    // List the cells of the patches in dispersive materials, and give them the parameters the update needs
+    void compactMaterials();            // Build materialMap, once the parameters are final
+    void rasterise(pointInPolygon &p, double shiftX, double shiftY, double **a, double valueA, double **b, double valueB, int jFirst, int jLast);     // Set a and b in rows jFirst to jLast wherever the point of the interior cell, shifted by (shiftX, shiftY) cells, is inside p
+    void areaFraction(pointInPolygon &p, double shiftX, double shiftY, char component, double **a, double valueA, double **b, double valueB, int jFirst, int jLast);     // As rasterise, but a cell the edges go through gets a mix weighted by how much of it p covers, component ('x', 'y' or 'z') gives the direction of the field
+    void rasteriseRows(const MaterialIndex &index, const std::vector<int> &group, int jFirst, int jLast);     // The materials of group in order, rows jFirst to jLast
+    void yuMittraRows(const std::vector<Point> &polygon, int jFirst, int jLast);         // Yu-Mittra averaging of epsU
+    void yuMittraColumns(const std::vector<Point> &polygon, int iFirst, int iLast);      // and of epsR
+    static void lineCrossings(const std::vector<Point> &polygon, int first, int last, double offset, double d, std::vector<int> &start, std::vector<double> &crossing);     // x where the edges cross the lines y = (k+offset)*d, in edge order, line k from crossing[start[k-first]]
+    void updateFields();                // Run the steps from firstStep on, this is the body of a worker thread
 };
 
 #endif // FIELD_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "gridpool.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+GridPool::GridPool()
+{
+}
+
+GridPool::~GridPool()
+{
+    trim();
+}
+
+double** GridPool::create(int nx, int ny)
+{
+    // The row pointers are stored in front of the data, so a single free() releases everything.
+    // calloc hands out fresh zero pages for large blocks, so nothing is written until the grid is used.
+    size_t header = nx*sizeof(double*);
+    char *memory = (char*)calloc(header + (size_t)nx*ny*sizeof(double), 1);
+    if(memory == NULL)
+        throw std::bad_alloc();
+
+    double **rows = (double**)memory;
+    double *data = (double*)(memory + header);
+    for(int i=0; i<nx; i++)
+        rows[i] = data + (size_t)i*ny;
+
+    return rows;
+}
+
+double** GridPool::allocate(int nx, int ny)
+{
+    for(int k=0; k<(int)unused.size(); k++) {
+        if(unused[k].nx == nx && unused[k].ny == ny) {
+            double **rows = unused[k].rows;
+            memset(rows[0], 0, (size_t)nx*ny*sizeof(double));     // Still cheaper than a new page fault per 4 kB
+
+            unused[k] = unused.back();
+            unused.pop_back();
+            return rows;
+        }
+    }
+
+    return create(nx, ny);
+}
+
+double** GridPool::allocate(int nx, int ny, double value)
+{
+    double **rows = allocate(nx, ny);
+    std::fill(rows[0], rows[0] + (size_t)nx*ny, value);
+    return rows;
+}
+
+void GridPool::release(double **a, int nx, int ny)
+{
+    if(a == NULL)
+        return;
+
+    Block b;
+    b.rows = a;
+    b.nx = nx;
+    b.ny = ny;
+    unused.push_back(b);
+}
+
+void GridPool::trim()
+{
+    for(int k=0; k<(int)unused.size(); k++)
+        free(unused[k].rows);
+    unused.clear();
+}
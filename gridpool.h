@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GRIDPOOL_H
+#define GRIDPOOL_H
+
+#include <vector>
+
+class GridPool
+{
+public:
+    GridPool();
+    ~GridPool();
+    double** allocate(int nx, int ny);                  // Zeroed nx by ny array, all rows share one contiguous block
+    double** allocate(int nx, int ny, double value);    // Same, but every element is set to value
+    void release(double **a, int nx, int ny);          // Hand the array back, it is reused by the next allocate of the same size
+    void trim();                                        // Free every array that was not reused
+
+private:
+    struct Block {
+        double **rows;
+        int nx, ny;
+    };
+    std::vector<Block> unused;
+
+    static double** create(int nx, int ny);
+};
+
+#endif // GRIDPOOL_H
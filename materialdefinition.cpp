@@ -16,7 +16,6 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <QDebug>
 #include "materialdefinition.h"
 
 MaterialDefinition::MaterialDefinition()
@@ -33,4 +32,12 @@ MaterialDefinition& MaterialDefinition::operator=(const MaterialDefinition& a)
     this->sigma = a.sigma;
     this->index = a.index;
     this->YuMittra = a.YuMittra;
+    this->areaFraction = a.areaFraction;
+    this->PEC = a.PEC;
+    this->SIBC = a.SIBC;
+    this->dispersion = a.dispersion;
+    this->deltaEps = a.deltaEps;
+    this->poleFrequency = a.poleFrequency;
+    this->damping = a.damping;
+    return *this;
 }
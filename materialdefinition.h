@@ -20,7 +20,6 @@
 #define MATERIALDEFINITION_H
 
 #include <vector>
-#include "coordinatetable.h"
 #include "point.h"
 
 //class QCPItemLine;
@@ -33,6 +32,13 @@ public:
     double epsr=1, mur=1, sigma=0;
     int index=0;            // This is set to -1 during first creation and remembers that the material can still be deleted if the user presses cancel
     int YuMittra=0;         // Bool would be better, but then there are conflicts when using stream
+    int areaFraction=0;     // Average the cells on the boundary by how much of them the material covers, takes the place of Yu-Mittra
+    int PEC=0;              // Perfect electric conductor, E stays zero, epsr, sigma, dispersion and the subcell options do not apply
+    int SIBC=0;             // Good conductor of conductivity sigma, left out as a PEC, with its surface impedance on the boundary instead
+    int dispersion=0;       // 0: none, 1: Drude, 2: Lorentz, 3: Debye, epsr is then epsilon at infinite frequency
+    double deltaEps=0;      // Lorentz and Debye, epsilon at zero frequency minus epsr
+    double poleFrequency=0; // MHz, plasma frequency (Drude), resonance (Lorentz) or 1/(2 pi tau) (Debye)
+    double damping=0;       // MHz, collision frequency (Drude) or line width (Lorentz), divided by 2 pi
     bool plotted=false;     // Necessary to know whether or not the square is drawn on the plot, using this it's no longer necessary to recreate the entire plot
 
     MaterialDefinition();
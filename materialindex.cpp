@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "materialindex.h"
+#include "pointinpolygon.h"
+#include <algorithm>
+#include <cmath>
+
+MaterialIndex::MaterialIndex()
+{
+}
+
+void MaterialIndex::build(const std::vector<MaterialDefinition> &materials)
+{
+    this->materials = &materials;
+    int n = materials.size();
+    polygons.assign(n, std::vector<Point>());
+    xMin.assign(n, 0); xMax.assign(n, 0); yMin.assign(n, 0); yMax.assign(n, 0);
+
+    for(int k=0; k<n; k++) {
+        const std::vector<Point> &p = materials[k].p;
+        if(p.size() == 2) {
+            polygons[k].push_back(Point(p[0].x, p[0].y));
+            polygons[k].push_back(Point(p[0].x, p[1].y));
+            polygons[k].push_back(Point(p[1].x, p[1].y));
+            polygons[k].push_back(Point(p[1].x, p[0].y));
+        }
+        else
+            polygons[k] = p;
+
+        if(polygons[k].size() == 0)
+            continue;
+        xMin[k] = xMax[k] = polygons[k][0].x;
+        yMin[k] = yMax[k] = polygons[k][0].y;
+        for(int m=1; m<(int)polygons[k].size(); m++) {
+            xMin[k] = std::min(xMin[k], polygons[k][m].x); xMax[k] = std::max(xMax[k], polygons[k][m].x);
+            yMin[k] = std::min(yMin[k], polygons[k][m].y); yMax[k] = std::max(yMax[k], polygons[k][m].y);
+        }
+    }
+
+    // About one material per bin, over the box that holds all of them
+    binsX = binsY = 0;
+    binStart.clear();
+    binMaterials.clear();
+    if(n == 0)
+        return;
+
+    left = *std::min_element(xMin.begin(), xMin.end());
+    bottom = *std::min_element(yMin.begin(), yMin.end());
+    double width = *std::max_element(xMax.begin(), xMax.end()) - left;
+    double height = *std::max_element(yMax.begin(), yMax.end()) - bottom;
+    binsX = binsY = std::min((int)ceil(sqrt((double)n)), 1024);
+    binWidth = width > 0 ? width/binsX : 1;
+    binHeight = height > 0 ? height/binsY : 1;
+
+    std::vector<int> count(binsX*binsY+1, 0);
+    for(int pass=0; pass<2; pass++) {           // Count, then fill, every material goes in every bin its box touches
+        for(int k=0; k<n; k++) {
+            for(int bx=binX(xMin[k]); bx<=binX(xMax[k]); bx++) {
+                for(int by=binY(yMin[k]); by<=binY(yMax[k]); by++) {
+                    if(pass == 0)
+                        count[bx*binsY+by+1]++;
+                    else
+                        binMaterials[count[bx*binsY+by]++] = k;
+                }
+            }
+        }
+
+        if(pass == 0) {
+            for(int b=0; b<binsX*binsY; b++)
+                count[b+1] += count[b];
+            binStart = count;
+            binMaterials.resize(count[binsX*binsY]);
+        }
+    }
+}
+
+int MaterialIndex::binX(double x) const
+{
+    return std::max(0, std::min(binsX-1, (int)std::max(floor((x-left)/binWidth), -1.0)));
+}
+
+int MaterialIndex::binY(double y) const
+{
+    return std::max(0, std::min(binsY-1, (int)std::max(floor((y-bottom)/binHeight), -1.0)));
+}
+
+void MaterialIndex::query(double x0, double y0, double x1, double y1, std::vector<int> &result) const
+{
+    result.clear();
+    if(binsX == 0)
+        return;
+
+    for(int bx=binX(x0); bx<=binX(x1); bx++) {
+        for(int by=binY(y0); by<=binY(y1); by++) {
+            int b = bx*binsY+by;
+            for(int m=binStart[b]; m<binStart[b+1]; m++) {
+                int k = binMaterials[m];
+                if(xMin[k] <= x1 && xMax[k] >= x0 && yMin[k] <= y1 && yMax[k] >= y0)
+                    result.push_back(k);
+            }
+        }
+    }
+
+    // A material that spans several bins is found more than once
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+int MaterialIndex::materialAt(double x, double y) const
+{
+    if(binsX == 0)
+        return -1;
+
+    int b = binX(x)*binsY+binY(y);
+    for(int m=binStart[b+1]-1; m>=binStart[b]; m--) {           // Bins are in order, so the last match is on top
+        int k = binMaterials[m];
+        if(x < xMin[k] || x > xMax[k] || y < yMin[k] || y > yMax[k])
+            continue;
+
+        pointInPolygon p;
+        p.vertices = &polygons[k];
+        if(p.inPolygon(x, y))
+            return k;
+    }
+    return -1;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MATERIALINDEX_H
+#define MATERIALINDEX_H
+
+#include <vector>
+#include <cstddef>
+#include "point.h"
+#include "materialdefinition.h"
+
+//
+// Uniform bins over the bounding boxes of the materials, so a region or a point only
+// looks at the materials near it instead of all of them
+//
+class MaterialIndex
+{
+public:
+    MaterialIndex();
+    void build(const std::vector<MaterialDefinition> &materials);     // Again after every change of the materials
+
+    const std::vector<MaterialDefinition> *materials=NULL;
+    std::vector<std::vector<Point> > polygons;          // Vertices of every material, a rectangle by its four corners
+    std::vector<double> xMin, xMax, yMin, yMax;         // Bounding box of every material
+
+    void query(double x0, double y0, double x1, double y1, std::vector<int> &result) const;     // Materials whose bounding box overlaps, in order
+    int materialAt(double x, double y) const;           // Last material containing the point, it is the one that is used, -1 if none
+
+private:
+    double left=0, bottom=0, binWidth=1, binHeight=1;
+    int binsX=0, binsY=0;
+    std::vector<int> binStart, binMaterials;            // The materials of bin b are binMaterials[binStart[b]] up to binMaterials[binStart[b+1]]
+
+    int binX(double x) const;
+    int binY(double y) const;
+};
+
+#endif // MATERIALINDEX_H
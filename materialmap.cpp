@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "materialmap.h"
+#include <map>
+#include <utility>
+
+MaterialMap::MaterialMap()
+{
+}
+
+bool MaterialMap::build(double **epsU, double **sigmaU, double **epsR, double **sigmaR, double **muC, int nx, int ny, double dt)
+{
+    this->ny = ny;
+    compact = false;
+    table.clear();
+    idU.assign(nx*ny, 0);
+    idR.assign(nx*ny, 0);
+    idC.assign(nx*ny, 0);
+
+    // The coefficients are those the update computes itself, so both give the same fields
+    std::map<std::pair<double, double>, int> entries;
+    auto lookUp = [&](double a, double b, int &last) -> int {
+        if(last >= 0 && table[last].a == a && table[last].b == b)        // Mostly the same as the cell before
+            return last;
+
+        std::pair<double, double> key(a, b);
+        std::map<std::pair<double, double>, int>::iterator it = entries.find(key);
+        if(it != entries.end())
+            return last = it->second;
+
+        Coefficients coefficients = {a, b};
+        table.push_back(coefficients);
+        entries[key] = table.size()-1;
+        return last = table.size()-1;
+    };
+
+    int lastU = -1, lastR = -1, lastC = -1;
+    for(int i=0; i<nx; i++) {
+        for(int j=0; j<ny; j++) {
+            double C = sigmaU[i][j]*dt/(2*epsU[i][j]);
+            int u = lookUp((1-C)/(1+C), dt/epsU[i][j]/(1+C), lastU);
+
+            C = sigmaR[i][j]*dt/(2*epsR[i][j]);
+            int r = lookUp((1-C)/(1+C), dt/epsR[i][j]/(1+C), lastR);
+
+            int h = lookUp(1, dt/muC[i][j], lastC);
+
+            if(table.size() > maxEntries) {     // Conformal averaging made too many, keep the parameters
+                table.clear();
+                idU.clear();
+                idR.clear();
+                idC.clear();
+                return false;
+            }
+
+            idU[i*ny+j] = u;
+            idR[i*ny+j] = r;
+            idC[i*ny+j] = h;
+        }
+    }
+
+    compact = true;
+    return true;
+}
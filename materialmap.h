@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef MATERIALMAP_H
+#define MATERIALMAP_H
+
+#include <vector>
+#include <cstdint>
+
+//
+// A grid holds only a few different materials, so the update reads a 16 bit number per
+// component and cell and looks its coefficients up, instead of reading the parameters
+//
+class MaterialMap
+{
+public:
+    struct Coefficients {
+        double a, b;                    // E = a*E + b*curl H, or Hz = Hz + b*curl E
+    };
+
+    MaterialMap();
+    bool build(double **epsU, double **sigmaU, double **epsR, double **sigmaR, double **muC, int nx, int ny, double dt);    // Again after the materials changed, false if there are too many different cells to pay off
+
+    bool compact=false;                 // The update uses the map, otherwise it reads the parameters of every cell
+    int ny=0;
+    std::vector<uint16_t> idU, idR, idC;        // Entry of Ex, Ey and Hz of cell (i, j) at i*ny+j
+    std::vector<Coefficients> table;
+
+    static const int maxEntries = 4096;         // Beyond this the table no longer stays in the cache, which was the point
+};
+
+#endif // MATERIALMAP_H
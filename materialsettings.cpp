@@ -52,6 +52,16 @@ void MaterialSettings::updateValues()
     ui->mur->setValue(material.mur);
     ui->sigma->setValue(material.sigma);
     ui->YuMittra->setChecked(material.YuMittra);
+    ui->areaFraction->setChecked(material.areaFraction);
+    ui->PEC->setChecked(material.PEC);
+    ui->SIBC->setChecked(material.SIBC);
+    on_PEC_clicked();
+    on_SIBC_clicked();
+    ui->deltaEps->setValue(material.deltaEps);
+    ui->poleFrequency->setValue(material.poleFrequency);
+    ui->damping->setValue(material.damping);
+    ui->dispersion->setCurrentIndex(material.dispersion);
+    on_dispersion_currentIndexChanged(material.dispersion);        // Not emitted if the index stays the same
 }
 
 void MaterialSettings::drawingFinished()
@@ -80,6 +90,51 @@ void MaterialSettings::on_sigma_valueChanged(double value)
     material.sigma = value;
 }
 
+void MaterialSettings::on_PEC_clicked()
+{
+    material.PEC = ui->PEC->isChecked();
+    if(material.PEC == true) {
+        material.SIBC = false;
+        ui->SIBC->setChecked(false);
+    }
+    ui->epsr->setEnabled(!material.PEC && !material.SIBC);     // A conductor has neither
+    ui->sigma->setEnabled(!material.PEC);
+}
+
+void MaterialSettings::on_SIBC_clicked()
+{
+    material.SIBC = ui->SIBC->isChecked();
+    if(material.SIBC == true) {
+        material.PEC = false;
+        ui->PEC->setChecked(false);
+    }
+    ui->epsr->setEnabled(!material.PEC && !material.SIBC);     // Its impedance only depends on sigma and mur
+    ui->sigma->setEnabled(!material.PEC);
+}
+
+void MaterialSettings::on_dispersion_currentIndexChanged(int index)
+{
+    material.dispersion = index;
+    ui->deltaEps->setEnabled(index == 2 || index == 3);      // Drude has none
+    ui->damping->setEnabled(index == 1 || index == 2);       // Debye has none
+    ui->poleFrequency->setEnabled(index != 0);
+}
+
+void MaterialSettings::on_deltaEps_valueChanged(double value)
+{
+    material.deltaEps = value;
+}
+
+void MaterialSettings::on_poleFrequency_valueChanged(double value)
+{
+    material.poleFrequency = value;
+}
+
+void MaterialSettings::on_damping_valueChanged(double value)
+{
+    material.damping = value;
+}
+
 void MaterialSettings::on_cancel_clicked()
 {
     if(type == 's')
@@ -178,4 +233,18 @@ void MaterialSettings::on_YuMittra_clicked()
     }
     else
         material.YuMittra = ui->YuMittra->isChecked();
+
+    if(material.YuMittra == true) {         // Only one of both
+        material.areaFraction = false;
+        ui->areaFraction->setChecked(false);
+    }
+}
+
+void MaterialSettings::on_areaFraction_clicked()
+{
+    material.areaFraction = ui->areaFraction->isChecked();
+    if(material.areaFraction == true) {
+        material.YuMittra = false;
+        ui->YuMittra->setChecked(false);
+    }
 }
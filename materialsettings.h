@@ -23,6 +23,7 @@
 #include <QStandardItemModel>
 #include "materialdefinition.h"
 #include "point.h"
+#include "coordinatetable.h"
 
 namespace Ui {
 class MaterialSettings;
@@ -64,6 +65,13 @@ private slots:
     void on_removeRow_clicked();
     void on_polygon_clicked();
     void on_YuMittra_clicked();
+    void on_areaFraction_clicked();
+    void on_PEC_clicked();
+    void on_SIBC_clicked();
+    void on_dispersion_currentIndexChanged(int index);
+    void on_deltaEps_valueChanged(double value);
+    void on_poleFrequency_valueChanged(double value);
+    void on_damping_valueChanged(double value);
 };
 
 #endif // MATERIALSETTINGS_H
@@ -18,7 +18,6 @@
 
 #include "planewave.h"
 #include "math.h"
-#include <qdebug.h>
 #include <algorithm>
 
 #define eta         377                 // Free space impedance
@@ -18,31 +18,24 @@
 
 #include "pmlboundary.h"
 #include <math.h>
-#include <qdebug.h>
 
 #define c           299792458
 #define epsilon0    8.8541878176E-12
 #define mu0         1.2566370614E-6
 #define Z1          mu0/epsilon0        // Free space impedance squared
 
-PMLBoundary::PMLBoundary(Settings settings, QWaitCondition *waitCondition, QMutex *mutex, int *threadCounter)
+PMLBoundary::PMLBoundary(Settings settings, ThreadSync *sync)
 {
     this->settings = settings;
-    this->computation = waitCondition;
-    this->mutex = mutex;
-    this->threadCounter = threadCounter;
+    this->sync = sync;
 }
 
 PMLBoundary::~PMLBoundary()
 {
     for(int k=0; k<8; k++) {
         for(int n=0; n<sizeWorkBuffer; n++) {
-            for(int i=0; i<patch[k].iMax - patch[k].iMin; i++) {
-                delete[] Hzx[k][n][i];
-                delete[] Hzy[k][n][i];
-            }
-            delete[] Hzx[k][n];
-            delete[] Hzy[k][n];
+            pool->release(Hzx[k][n], patch[k].iMax - patch[k].iMin, patch[k].jMax - patch[k].jMin);
+            pool->release(Hzy[k][n], patch[k].iMax - patch[k].iMin, patch[k].jMax - patch[k].jMin);
         }
         delete[] Hzx[k];
         delete[] Hzy[k];
@@ -77,16 +70,8 @@ void PMLBoundary::initBoundary()
         Hzx[k] = new double**[sizeWorkBuffer];
         Hzy[k] = new double**[sizeWorkBuffer];
         for(int n=0; n<field->sizeWorkBuffer; n++) {
-            Hzx[k][n] = new double*[patch[k].iMax - patch[k].iMin];
-            Hzy[k][n] = new double*[patch[k].iMax - patch[k].iMin];
-            for(int i=0; i<patch[k].iMax - patch[k].iMin; i++) {
-                Hzx[k][n][i] = new double[patch[k].jMax - patch[k].jMin];
-                Hzy[k][n][i] = new double[patch[k].jMax - patch[k].jMin];
-                for(int j=0; j<patch[k].jMax - patch[k].jMin; j++) {
-                    Hzx[k][n][i][j] = 0;
-                    Hzy[k][n][i][j] = 0;
-                }
-            }
+            Hzx[k][n] = pool->allocate(patch[k].iMax - patch[k].iMin, patch[k].jMax - patch[k].jMin);     // Zero initialized
+            Hzy[k][n] = pool->allocate(patch[k].iMax - patch[k].iMin, patch[k].jMax - patch[k].jMin);
         }
     }
     sigmaX = new double[settings.PMLlayers];
@@ -115,6 +100,7 @@ void PMLBoundary::mapFields(Field *a)
 {
     this->field = a;
     this->sizeWorkBuffer = a->sizeWorkBuffer;
+    this->pool = a->pool;
     this->WBEx = a->WBEx;
     this->WBEy = a->WBEy;
     this->WBHz = a->WBHz;
@@ -126,22 +112,14 @@ void PMLBoundary::mapFields(Field *a)
 void PMLBoundary::updateFields()
 {
     // Hz in the regular domain is mapped to Hzy
-    for(int n=0; n<settings.steps; n++) {       // Loop over time
+    for(int n=firstStep; n<settings.steps; n++) {       // Loop over time
         int Old = (n-1+sizeWorkBuffer)%sizeWorkBuffer;      // Old time
         int New = n%sizeWorkBuffer;                         // New time
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads) {
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        }
-        else {
-            *threadCounter = 0;
+        sync->synchronize(settings.numberOfThreads, [&]{
             if(n%field->settings.sampleDistance == 0)
                 field->transferSample(n);        // Transfer sample from work buffer to output buffer
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        });
 
         for(int m=0; m<8; m++) {                // Loop over boundary
             for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
@@ -224,15 +202,7 @@ void PMLBoundary::updateFields()
             }
         }
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads)
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        else {
-            *threadCounter = 0;
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        sync->synchronize(settings.numberOfThreads);
 
         for(int m=0; m<8; m++) {                // Loop over boundary
             for(int i=patch[m].iMin; i<patch[m].iMax; i++) {
@@ -323,20 +293,15 @@ void PMLBoundary::updateFields()
             }
         }
 
-        mutex->lock();
-        (*threadCounter)++;
-        if(*threadCounter < settings.numberOfThreads)
-            computation->wait(mutex);              // Wait for the other threads to synchronize
-        else {
-            *threadCounter = 0;
-            emit fieldUpdateFinished(n);
-            computation->wakeAll();
-        }
-        mutex->unlock();
+        bool proceed = sync->synchronize(settings.numberOfThreads, [&]{
+            if(sync->stepFinished)
+                sync->stepFinished(n);
+        });
 
-        if(n > settings.steps-2) {
-            emit updateGUI(0, 0, 0, 0, 0, 0);
-            emit finished();
-        }
+        if(!proceed)
+            break;                  // Cancelled, every thread stops after the same step
     }
+
+    if(sync->threadFinished)
+        sync->threadFinished(0, 0, 0, 0, 0, 0);
 }
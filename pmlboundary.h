@@ -20,44 +20,36 @@
 #define PMLBOUNDARY_H
 
 #include <vector>
-#include <QObject>
 #include "area.h"
 #include "settings.h"
 #include "field.h"
+#include "threadsync.h"
 
 
-class PMLBoundary : public QObject
+class PMLBoundary
 {
-    Q_OBJECT
 public:
     double ***WBEx=NULL, ***WBEy=NULL, ***WBHz=NULL, **epsR=NULL, **epsU=NULL;      // WB = workbuffer
     double **muC=NULL, *sigmaX=NULL, *sigmaY=NULL, *sigmaX2=NULL, *sigmaY2=NULL;
     double ****Hzx=NULL, ****Hzy=NULL;
-    int* threadCounter;
+    ThreadSync *sync;               // Shared with the threads of the interior
+    GridPool *pool=NULL;            // Taken from the mapped field
     int sizeWorkBuffer;
+    int firstStep=0;                // Non-zero when a finished run is continued
     double dx, dy, dt;
 
     std::vector<Area> patch;        // Order: LU, T, RU, L, R, LB, B, RB (LU = left upper, T = top, ...)
     Settings settings;
-    PMLBoundary(Settings settings, QWaitCondition *waitCondition, QMutex* mutex, int* threadCounter);
+    PMLBoundary(Settings settings, ThreadSync *sync);
     ~PMLBoundary();
 
     void defineBoundary();
     void mapFields(Field *a);
     void initBoundary();
-
-public slots:
-    void updateFields();
+    void updateFields();            // Run the steps from firstStep on, this is the body of the boundary thread
 
 private:
-    QMutex *mutex;
-    QWaitCondition* computation;
     Field *field;
-
-signals:
-    void fieldUpdateFinished(int n);
-    void updateGUI(double, double, double, double, double, double);
-    void finished();
 };
 
 #endif // PMLBOUNDARY_H
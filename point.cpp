@@ -33,4 +33,5 @@ Point& Point::operator=(const Point& p)
 {
     this->x = p.x;
     this->y = p.y;
+    return *this;
 }
@@ -35,6 +35,93 @@ int pointInPolygon::inPolygon(double x, double y)
     return c;
 }
 
+void pointInPolygon::crossings(double y, std::vector<double> &crossing)
+{
+    crossing.clear();                   // Computed as in inPolygon so the result is the same
+    int i, j, nvert=vertices->size();
+    for (i = 0, j = nvert-1; i < nvert; j = i++) {
+        if (((*vertices)[i].y>y) != ((*vertices)[j].y>y))
+            crossing.push_back(((*vertices)[j].x-(*vertices)[i].x) * (y-(*vertices)[i].y) / ((*vertices)[j].y-(*vertices)[i].y) + (*vertices)[i].x);
+    }
+    std::sort(crossing.begin(), crossing.end());
+}
+
+void pointInPolygon::spans(const std::vector<double> &x, double y, std::vector<int> &span)
+{
+    std::vector<double> crossing;
+    crossings(y, crossing);
+
+    span.clear();                       // x[k] is inside if an odd number of crossings lies at or left of it
+    for(int m=0; m<(int)crossing.size(); m++)
+        span.push_back(std::lower_bound(x.begin(), x.end(), crossing[m]) - x.begin());
+}
+
+double pointInPolygon::nearestExterior(const double *crossing, int n, double x)
+{
+    double minDistance = INF, signedDistance = INF, sign=-1;        // Find the distance with the lowest absolute value, and return the signed type, the sign determines on which side the exterior of the edge is
+    for(int k=0; k<n; k++)
+    {
+        double distance = crossing[k] - x;
+        if(distance < 0)
+            sign = sign > 0 ? -1 : 1;                               // Only work at the exterior of the polygon
+
+        if(sign < 0 && minDistance > std::abs(distance)) {
+            minDistance = std::abs(distance);
+            signedDistance = distance;
+        }
+    }
+    return signedDistance;
+}
+
+void pointInPolygon::clip(const std::vector<Point> &polygon, char axis, double low, double high, std::vector<Point> &result)
+{
+    std::vector<Point> half;
+    for(int side=0; side<2; side++) {           // Sutherland-Hodgman, first against low, then against high
+        const std::vector<Point> &in = side == 0 ? polygon : half;
+        std::vector<Point> &out = side == 0 ? half : result;
+        double bound = side == 0 ? low : high, sign = side == 0 ? 1 : -1;
+        out.clear();
+
+        int n = in.size();
+        for(int i=0; i<n; i++) {
+            const Point &a = in[(i+n-1)%n], &b = in[i];         // The edge from a to b
+            double ua = axis == 'x' ? a.x : a.y, ub = axis == 'x' ? b.x : b.y;
+            bool insideA = sign*(ua-bound) >= 0, insideB = sign*(ub-bound) >= 0;
+
+            if(insideA != insideB) {            // The new vertex lies exactly on the bound, area uses that
+                double t = (bound-ua)/(ub-ua);
+                out.push_back(axis == 'x' ? Point(bound, a.y + t*(b.y-a.y)) : Point(a.x + t*(b.x-a.x), bound));
+            }
+            if(insideB)
+                out.push_back(b);
+        }
+    }
+}
+
+double pointInPolygon::area(const std::vector<Point> &polygon, double xLow, double xHigh, double yLow, double yHigh, double &nx, double &ny)
+{
+    double twice = 0;
+    nx = ny = 0;
+
+    int i, j, n=polygon.size();
+    for (i = 0, j = n-1; i < n; j = i++) {
+        const Point &a = polygon[j], &b = polygon[i];
+        twice += (a.x-xLow)*(b.y-yLow) - (b.x-xLow)*(a.y-yLow);     // Relative to the box, the cell is small compared to the coordinates
+
+        bool side = (a.x == xLow && b.x == xLow) || (a.x == xHigh && b.x == xHigh) || (a.y == yLow && b.y == yLow) || (a.y == yHigh && b.y == yHigh);
+        if(!side) {                             // Part of the material boundary
+            nx += b.y-a.y;
+            ny += a.x-b.x;
+        }
+    }
+
+    if(twice < 0) {                             // Clockwise, the normal pointed inwards
+        nx = -nx;
+        ny = -ny;
+    }
+    return std::abs(twice)/2;
+}
+
 double pointInPolygon::distanceX(double x, double y)
 {
     std::vector<double> distance;
@@ -46,23 +133,7 @@ double pointInPolygon::distanceX(double x, double y)
 //            qDebug() << x - ((*vertices)[j].x-(*vertices)[i].x) * (y-(*vertices)[i].y) / ((*vertices)[j].y-(*vertices)[i].y) + (*vertices)[i].x;
     }
 
-    if(distance.size() > 0)
-    {
-        double minDistance = INF, signedDistance = INF, sign=-1;        // Find the distance with the lowest absolute value, and return the signed type, the sign determines if the exterior of the edge is to the right or left
-        for(int k=0; k<distance.size(); k++)
-        {
-            if(distance[k] < 0)
-                sign = sign > 0 ? -1 : 1;                               // Only work at the exterior of the polygon
-
-            if(sign < 0 && minDistance > std::abs(distance[k])) {
-                minDistance = std::abs(distance[k]);
-                signedDistance = distance[k];
-            }
-        }
-        return signedDistance;
-    }
-
-    return INF;
+    return nearestExterior(distance.data(), distance.size(), 0);
 }
 
 double pointInPolygon::distanceY(double x, double y)
@@ -76,22 +147,5 @@ double pointInPolygon::distanceY(double x, double y)
 //            qDebug() << x - ((*vertices)[j].x-(*vertices)[i].x) * (y-(*vertices)[i].y) / ((*vertices)[j].y-(*vertices)[i].y) + (*vertices)[i].x;
     }
 
-    if(distance.size() > 0)
-    {
-        double minDistance = INF, signedDistance = INF, sign=-1;        // Find the distance with the lowest absolute value, and return the signed type, the sign determines if the exterior of the edge is to the top or bottom
-        for(int k=0; k<distance.size(); k++)
-        {
-            if(distance[k] < 0)
-                sign = sign > 0 ? -1 : 1;                               // Only work at the exterior of the polygon
-
-            if(sign < 0 && minDistance > std::abs(distance[k])) {
-                minDistance = std::abs(distance[k]);
-                signedDistance = distance[k];
-            }
-
-        }
-        return signedDistance;
-    }
-
-    return INF;
+    return nearestExterior(distance.data(), distance.size(), 0);
 }
@@ -21,16 +21,21 @@
 
 #include "point.h"
 #include <vector>
-#include <QDebug>
 #include <cmath>
+#include <algorithm>
 
 class pointInPolygon
 {
 public:
     pointInPolygon();
     int inPolygon(double x, double y);
+    void crossings(double y, std::vector<double> &crossing);        // Sorted x where the edges cross the line at y, x is inside from an even to the next odd one
+    void spans(const std::vector<double> &x, double y, std::vector<int> &span);     // x[span[2m]] up to x[span[2m+1]] are inside, for ascending x
     double distanceX(double x, double y);       // Returns the x distance between the given point and the closest edge
     double distanceY(double x, double y);       // Returns the y distance between the given point and the closest edge
+    static double nearestExterior(const double *crossing, int n, double x);     // Signed distance from x to the closest of the crossings, in edge order, as distanceX and distanceY choose it
+    static void clip(const std::vector<Point> &polygon, char axis, double low, double high, std::vector<Point> &result);      // The part of polygon where low <= x <= high (axis 'x') or low <= y <= high (axis 'y')
+    static double area(const std::vector<Point> &polygon, double xLow, double xHigh, double yLow, double yHigh, double &nx, double &ny);     // Area of polygon clipped to the box, (nx, ny) is the outward normal times the length of its edges inside the box
 
     const std::vector<Point> *vertices;
 };
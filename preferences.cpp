@@ -52,6 +52,7 @@ Preferences::Preferences(QWidget *parent, Settings* settings) :
     ui->height->setValue(settings->height);
     ui->width->setValue(settings->width);
     ui->DrawNthField->setValue(settings->drawNthField);
+    ui->memoryBudget->setValue(settings->memoryBudget);
 }
 
 Preferences::~Preferences()
@@ -202,6 +203,11 @@ void Preferences::on_height_valueChanged(int value)
     settings->height = value;
 }
 
+void Preferences::on_memoryBudget_valueChanged(int value)
+{
+    settings->memoryBudget = value;
+}
+
 void Preferences::on_DrawNthField_valueChanged(int value)
 {
     settings->drawNthField = value;
@@ -65,6 +65,7 @@ private slots:
     void on_sampleDistance_valueChanged(int value);
     void on_width_valueChanged(int value);
     void on_height_valueChanged(int value);
+    void on_memoryBudget_valueChanged(int value);
 
     // Computation
     void on_DrawNthField_valueChanged(int value);
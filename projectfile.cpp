@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "projectfile.h"
+
+#define settingsIndex   -1
+#define sourceIndex     0
+#define TFSFIndex       1
+#define materialIndex   2
+#define sensorIndex     3
+#define hsgIndex        4
+#define hsgSolverIndex  5       // Follows the subgrid it belongs to, older files do not have it
+#define hsgToleranceIndex 6     // Same
+#define materialSubcellIndex 7  // Follows the material it belongs to, older files do not have it
+#define materialDispersionIndex 8   // Same
+#define materialPECIndex 9      // Same
+#define materialSIBCIndex 10    // Same
+#define thinIndex       11
+
+void ProjectFile::read(QTextStream &stream, Settings &settings, std::vector<MaterialDefinition> &materials, std::vector<ThinDefinition> &thin, std::vector<currentSource> &currentSources,
+                       std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces)
+{
+    do {
+        int header;
+        stream >> header;       // Read the header
+
+        switch(header)
+        {
+        case settingsIndex:
+            stream >> settings.cellsX >> settings.cellsY >> settings.sizeX >> settings.sizeY >> settings.courant;
+            stream >> settings.sigmaXMax >> settings.sigmaYMax;
+            stream >> settings.m >> settings.steps >> settings.numberOfThreads >> settings.PMLlayers;
+            stream >> settings.width >> settings.height >> settings.sampleDistance >> settings.drawNthField;
+            break;
+
+        case materialIndex: {
+            int points;
+            stream >> points;
+            MaterialDefinition m;
+            m.p.clear();
+
+            for(int n=0; n<points; n++) {
+                double x, y;
+                stream >> x >> y;
+                m.p.push_back(Point(x, y));
+            }
+
+            stream >> m.epsr >> m.mur >> m.sigma >> m.YuMittra;
+            materials.push_back(m);
+            break; }
+
+        case thinIndex: {
+            int points;
+            stream >> points;
+            ThinDefinition t;
+            t.p.clear();
+
+            for(int n=0; n<points; n++) {
+                double x, y;
+                stream >> x >> y;
+                t.p.push_back(Point(x, y));
+            }
+
+            stream >> t.thickness >> t.epsr >> t.sigma;
+            t.type = stream.readLine(2)[1].toLatin1();
+            thin.push_back(t);
+            break; }
+
+        case sourceIndex: {
+            currentSource s;
+            stream >> s.frequency >> s.magnitude >> s.xpos >> s.ypos;
+            s.polarization = stream.readLine(2)[1].toLatin1();
+            s.type = stream.readLine(2)[1].toLatin1();
+            stream >> s.timeDelay >> s.pulseWidth >> s.frequencyG >> s.magnitudeG >> s.xposG >> s.yposG;
+            s.polarizationG = stream.readLine(2)[1].toLatin1();
+
+            currentSources.push_back(s);
+            break; }
+
+        case TFSFIndex: {
+            PlaneWave p;
+            stream >> p.timeDelay >> p.pulseWidth >> p.centerFrequency >> p.angle >> p.amplitude >> p.p[0].x >> p.p[0].y >> p.p[1].x >> p.p[1].y;
+            TFSF.push_back(p);
+            break; }
+
+        case sensorIndex: {
+            SensorDefinition s;
+            stream >> s.xpos >> s.ypos;
+            sensors.push_back(s);
+            break; }
+
+        case hsgIndex: {
+            SGInterface h;
+            stream >> h.p[0].x >> h.p[0].y >> h.p[1].x >> h.p[1].y >> h.xRatio >> h.yRatio;
+            hsgSurfaces.push_back(h);
+            break; }
+
+        case hsgSolverIndex:
+            if(hsgSurfaces.size() > 0)
+                stream >> hsgSurfaces.back().solverType;
+            break;
+
+        case materialSubcellIndex:
+            if(materials.size() > 0)
+                stream >> materials.back().areaFraction;
+            break;
+
+        case materialDispersionIndex:
+            if(materials.size() > 0)
+                stream >> materials.back().dispersion >> materials.back().deltaEps >> materials.back().poleFrequency >> materials.back().damping;
+            break;
+
+        case materialPECIndex:
+            if(materials.size() > 0)
+                stream >> materials.back().PEC;
+            break;
+
+        case materialSIBCIndex:
+            if(materials.size() > 0)
+                stream >> materials.back().SIBC;
+            break;
+
+        case hsgToleranceIndex:
+            if(hsgSurfaces.size() > 0)
+                stream >> hsgSurfaces.back().tolerance;
+            break;
+        }
+    } while(!stream.atEnd());
+}
+
+void ProjectFile::write(QTextStream &stream, const Settings &settings, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin, const std::vector<currentSource> &currentSources,
+                        const std::vector<PlaneWave> &TFSF, const std::vector<SensorDefinition> &sensors, const std::vector<SGInterface> &hsgSurfaces)
+{
+    stream << settingsIndex << endl;                // Export current settings
+    stream << settings.cellsX << " ";
+    stream << settings.cellsY << " ";
+    stream << settings.sizeX << " ";
+    stream << settings.sizeY << " ";
+    stream << settings.courant << " ";
+    stream << settings.sigmaXMax << " ";
+    stream << settings.sigmaYMax << " ";
+    stream << settings.m << " ";
+    stream << settings.steps << " ";
+    stream << settings.numberOfThreads << " ";
+    stream << settings.PMLlayers << " ";
+    stream << settings.width << " ";
+    stream << settings.height << " ";
+    stream << settings.sampleDistance << " ";
+    stream << settings.drawNthField << " ";
+
+    for(int k=0; k<materials.size(); k++) {
+        stream << endl << materialIndex << " " << materials[k].p.size() << endl;
+
+        for(int n=0; n<materials[k].p.size(); n++) {
+            stream << materials[k].p[n].x << " ";
+            stream << materials[k].p[n].y << " ";
+        }
+        stream << materials[k].epsr << " ";
+        stream << materials[k].mur << " ";
+        stream << materials[k].sigma << " ";
+        stream << materials[k].YuMittra;
+
+        stream << endl << materialSubcellIndex << endl;
+        stream << materials[k].areaFraction;
+
+        stream << endl << materialDispersionIndex << endl;
+        stream << materials[k].dispersion << " ";
+        stream << materials[k].deltaEps << " ";
+        stream << materials[k].poleFrequency << " ";
+        stream << materials[k].damping;
+
+        stream << endl << materialPECIndex << endl;
+        stream << materials[k].PEC;
+
+        stream << endl << materialSIBCIndex << endl;
+        stream << materials[k].SIBC;
+    }
+
+    for(int k=0; k<thin.size(); k++) {
+        stream << endl << thinIndex << " " << thin[k].p.size() << endl;
+
+        for(int n=0; n<thin[k].p.size(); n++) {
+            stream << thin[k].p[n].x << " ";
+            stream << thin[k].p[n].y << " ";
+        }
+        stream << thin[k].thickness << " ";
+        stream << thin[k].epsr << " ";
+        stream << thin[k].sigma << " ";
+        stream << thin[k].type;
+    }
+
+    for(int k=0; k<currentSources.size(); k++) {
+        stream << endl << sourceIndex << endl;
+
+        stream << currentSources[k].frequency << " ";
+        stream << currentSources[k].magnitude << " ";
+        stream << currentSources[k].xpos << " ";
+        stream << currentSources[k].ypos << " ";
+        stream << currentSources[k].polarization << " ";
+        stream << currentSources[k].type << " ";
+        stream << currentSources[k].timeDelay << " ";
+        stream << currentSources[k].pulseWidth << " ";
+        stream << currentSources[k].frequencyG << " ";
+        stream << currentSources[k].magnitudeG << " ";
+        stream << currentSources[k].xposG << " ";
+        stream << currentSources[k].yposG << " ";
+        stream << currentSources[k].polarizationG;
+    }
+
+    for(int k=0; k<TFSF.size(); k++) {
+        stream << endl << TFSFIndex << endl;
+
+        stream << TFSF[k].timeDelay << " ";
+        stream << TFSF[k].pulseWidth << " ";
+        stream << TFSF[k].centerFrequency << " ";
+        stream << TFSF[k].angle << " ";
+        stream << TFSF[k].amplitude << " ";
+        stream << TFSF[k].p[0].x << " ";
+        stream << TFSF[k].p[0].y << " ";
+        stream << TFSF[k].p[1].x << " ";
+        stream << TFSF[k].p[1].y;
+    }
+
+    for(int k=0; k<sensors.size(); k++) {
+        stream << endl << sensorIndex << endl;
+
+        stream << sensors[k].xpos << " ";
+        stream << sensors[k].ypos;
+    }
+
+    for(int k=0; k<hsgSurfaces.size(); k++) {
+        stream << endl << hsgIndex << endl;
+
+        stream << hsgSurfaces[k].p[0].x << " ";
+        stream << hsgSurfaces[k].p[0].y << " ";
+        stream << hsgSurfaces[k].p[1].x << " ";
+        stream << hsgSurfaces[k].p[1].y << " ";
+        stream << hsgSurfaces[k].xRatio << " ";
+        stream << hsgSurfaces[k].yRatio;
+
+        stream << endl << hsgSolverIndex << endl;
+        stream << hsgSurfaces[k].solverType;
+
+        stream << endl << hsgToleranceIndex << endl;
+        stream << hsgSurfaces[k].tolerance;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QTextStream>
+#include <vector>
+#include "settings.h"
+#include "currentsource.h"
+#include "materialdefinition.h"
+#include "thindefinition.h"
+#include "planewave.h"
+#include "sensordefinition.h"
+#include "sginterface.h"
+
+// Reads and writes the .bdd project files, shared by the main window and the batch runner
+class ProjectFile
+{
+public:
+    static void read(QTextStream &stream, Settings &settings, std::vector<MaterialDefinition> &materials, std::vector<ThinDefinition> &thin, std::vector<currentSource> &currentSources,
+                     std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces);
+    static void write(QTextStream &stream, const Settings &settings, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin, const std::vector<currentSource> &currentSources,
+                      const std::vector<PlaneWave> &TFSF, const std::vector<SensorDefinition> &sensors, const std::vector<SGInterface> &hsgSurfaces);
+};
+
+#endif // PROJECTFILE_H
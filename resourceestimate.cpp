@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "resourceestimate.h"
+#include "field.h"
+#include "gridpool.h"
+#include "threadsync.h"
+#include "materialindex.h"
+#include "dispersion.h"
+#include "surfaceimpedance.h"
+#include "sgfield.h"
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+ResourceEstimate::ResourceEstimate(Settings settings, const std::vector<currentSource> &sources, const std::vector<MaterialDefinition> &materials, const std::vector<PlaneWave> &TFSF,
+                                   const std::vector<SensorDefinition> &sensors, const std::vector<SGInterface> &hsgSurfaces)
+{
+    settings.computeDifferentials();
+    this->settings = settings;
+    this->TFSF = TFSF;
+
+    double nx = 2*settings.PMLlayers+settings.cellsX;
+    double ny = 2*settings.PMLlayers+settings.cellsY;
+    double grid = nx*ny*sizeof(double);
+    int sizeWorkBuffer = 4;                                 // Same as Field::sizeWorkBuffer
+
+    workBufferBytes = 3*sizeWorkBuffer*grid;                // Ex, Ey and Hz
+    materialBytes = 5*grid + 3*nx*ny*sizeof(uint16_t);       // epsR, epsU, muC, sigmaR and sigmaU, and the material map
+    PMLBytes = 2*sizeWorkBuffer*((nx-2)*(ny-2) - (double)settings.cellsX*settings.cellsY)*sizeof(double);   // Hzx and Hzy of the 8 patches
+    sensorBytes = sensors.size()*(3.0*settings.steps*sizeof(double) + 3.0*(settings.steps/2+1)*2*sizeof(double));
+
+    for(int k=0; k<(int)hsgSurfaces.size(); k++) {          // Same definitions as in the constructor of SGField
+        Point topRight = Point(std::max(hsgSurfaces[k].p[0].x, hsgSurfaces[k].p[1].x), std::max(hsgSurfaces[k].p[0].y, hsgSurfaces[k].p[1].y));
+        Point bottomLeft = Point(std::min(hsgSurfaces[k].p[0].x, hsgSurfaces[k].p[1].x), std::min(hsgSurfaces[k].p[0].y, hsgSurfaces[k].p[1].y));
+        topRight = Point(ceil(topRight.x/settings.dx)*settings.dx, ceil(topRight.y/settings.dy)*settings.dy);
+        bottomLeft = Point(ceil(bottomLeft.x/settings.dx)*settings.dx, ceil(bottomLeft.y/settings.dy)*settings.dy);
+
+        int cellsX = ceil((topRight.x - bottomLeft.x)/settings.dx);
+        int cellsY = ceil((topRight.y - bottomLeft.y)/settings.dy);
+        int xRatio = hsgSurfaces[k].xRatio, yRatio = hsgSurfaces[k].yRatio;
+
+        double sizeEx = (xRatio*(cellsX-2)+2.0)*(yRatio*(cellsY-2)+1.0);
+        double sizeEy = (xRatio*(cellsX-2)+1.0)*(yRatio*(cellsY-2)+2.0);
+        double sizeHz = (xRatio*(cellsX-2)+2.0)*(yRatio*(cellsY-2)+2.0);
+        double sizeE = sizeEx+sizeEy;
+        double N = sizeE+sizeHz;
+        double entry = sizeof(double)+sizeof(int);                 // Of a compressed sparse matrix
+
+        // Every solver keeps A, B and C, the row major copies of B and C, the work buffer, s, rhs, rhsH, the material parameters and the statistics
+        double nnzA = 3*sizeE + 5*sizeHz, nnzB = 3*sizeE + sizeHz, nnzC = 2*sizeE;
+        subgridBytes += (nnzA + 2*(nnzB+nnzC))*entry + 5*(N+1)*sizeof(int);
+        subgridBytes += (sizeWorkBuffer+3)*N*sizeof(double) + (sizeE+sizeHz)*sizeof(double) + settings.steps*(sizeof(int)+sizeof(double));
+
+        double nnzFG = 4*sizeHz + 2*sizeE;                          // F and G of the Schur and ADI solvers
+        switch(hsgSurfaces[k].solverType) {
+        case SGField::Iterative:
+            subgridBytes += (sqrt(xRatio*yRatio)+51)*nnzA*entry;   // The fill factor of the incomplete LUT, which keeps every entry it may
+            subgridBytes += 10*N*sizeof(double);                    // Its permutations and the BiCGSTAB vectors
+            break;
+        case SGField::DirectLU:
+            subgridBytes += (115+1.5*log2(N))*N*entry;              // Supernodes of SparseLU, measured on subgrids of ratio 2 to 8
+            break;
+        case SGField::Schur:                                        // Cholesky of I - F*G, if it is not symmetric the LU takes more
+            subgridBytes += nnzFG*entry + 2*(sizeE+sizeHz)*sizeof(int);
+            subgridBytes += 2.5*sizeHz*log2(sizeHz)*entry + 2*sizeHz*sizeof(double);
+            break;
+        case SGField::ADI:
+            subgridBytes += nnzFG*entry + 2*(sizeE+sizeHz)*sizeof(int);
+            subgridBytes += (9+6)*sizeHz*sizeof(double);            // The stencil and the Thomas factors, the BiCGSTAB vectors
+            break;
+        case SGField::Explicit:                                     // No factorisation, explicitE, explicitH and the state of the local steps
+            subgridBytes += (2*sizeE + 4*sizeHz)*entry + (sizeE+sizeHz)*sizeof(int);
+            subgridBytes += (3*sizeE + 2*sizeHz)*sizeof(double);
+            break;
+        }
+        subgridFrameBytes += N*sizeof(double);
+    }
+
+    // A dispersive material keeps a current for every E inside, a surface impedance the states of its poles for every E on the surface
+    MaterialIndex index;
+    index.build(materials);
+    int poles = ceil(log(1E6*settings.steps/2.0)/(log(10.0)/2)) + 1;         // As SurfaceImpedance::fit, before the fastest are dropped
+    for(int k=0; k<(int)materials.size(); k++) {
+        if(materials[k].PEC == true || (materials[k].SIBC != true && materials[k].dispersion == 0))
+            continue;
+
+        const std::vector<Point> &p = index.polygons[k];
+        double area = 0, crossings = 0;         // Cell edges the outline crosses, every one of them has an E on the surface
+        for(int m=0; m<(int)p.size(); m++) {
+            const Point &a = p[m], &b = p[(m+1)%p.size()];
+            area += (a.x*b.y - b.x*a.y)/2;
+            crossings += fabs(b.x-a.x)/settings.dx + fabs(b.y-a.y)/settings.dy + 1;
+        }
+
+        if(materials[k].SIBC == true)
+            auxiliaryBytes += crossings*(sizeof(SurfaceImpedance::Node) + poles*sizeof(double));
+        else
+            auxiliaryBytes += 2*(fabs(area)/(settings.dx*settings.dy) + crossings)*sizeof(Dispersion::Cell);      // Ex and Ey
+    }
+
+    bytesPerFrame = 3*grid + subgridFrameBytes;
+    frameBytes = frames()*bytesPerFrame;
+
+    for(int k=0; k<(int)sources.size(); k++) {
+        if(sources[k].type == 's')
+            maxFrequency = std::max(maxFrequency, sources[k].frequency*1E6);
+        else if(sources[k].pulseWidth > 0)  // Gaussian envelope, its spectrum has dropped by 80 dB at 3/(pi*pulseWidth) from the carrier
+            maxFrequency = std::max(maxFrequency, sources[k].frequencyG*1E6 + 3/(M_PI*sources[k].pulseWidth));
+    }
+
+    for(int k=0; k<(int)TFSF.size(); k++) {
+        if(TFSF[k].pulseWidth > 0)
+            maxFrequency = std::max(maxFrequency, TFSF[k].centerFrequency + 3/(M_PI*TFSF[k].pulseWidth));
+    }
+}
+
+int ResourceEstimate::frames() const
+{
+    return std::ceil((double)settings.steps/settings.sampleDistance);
+}
+
+double ResourceEstimate::totalBytes() const
+{
+    return workBufferBytes + frameBytes + materialBytes + auxiliaryBytes + PMLBytes + subgridBytes + sensorBytes;
+}
+
+int ResourceEstimate::nyquistSampleDistance() const
+{
+    if(maxFrequency <= 0)
+        return std::max(settings.steps, 1);
+
+    return std::max((int)floor(1/(2*maxFrequency*settings.dt)), 1);
+}
+
+int ResourceEstimate::fitSampleDistance(double budget) const
+{
+    double available = budget - (totalBytes() - frameBytes);
+    int maxFrames = floor(available/bytesPerFrame);
+    if(maxFrames < 1)
+        return 0;
+
+    return std::max((int)std::ceil((double)settings.steps/maxFrames), 1);
+}
+
+void ResourceEstimate::setSampleDistance(int sampleDistance)
+{
+    settings.sampleDistance = sampleDistance;
+    frameBytes = frames()*bytesPerFrame;
+}
+
+void ResourceEstimate::calibrate(int calibrationSteps)
+{
+    Settings s = settings;
+    s.steps = calibrationSteps;
+    s.sampleDistance = calibrationSteps;       // A single output frame
+    s.numberOfThreads = 1;                     // The barriers in Field::updateFields fall through
+
+    ThreadSync sync;
+    GridPool pool;
+
+    Field f(s, &sync);
+    f.pool = &pool;
+    f.initFields();
+    f.computeDifferentials();
+    f.patch.push_back(Area(s.PMLlayers, s.PMLlayers+s.cellsX, s.PMLlayers, s.PMLlayers+s.cellsY));
+
+    for(int k=0; k<(int)TFSF.size(); k++) {   // The TF/SF test sits in the inner loop, so it affects the speed
+        f.TFSF.push_back(TFSF[k]);
+        f.TFSF[k].settings = s;
+        f.TFSF[k].computePosition();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    f.updateFields();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    f.deleteFields();
+    secondsPerCellStep = elapsed.count()/((double)calibrationSteps*s.cellsX*s.cellsY);
+}
+
+double ResourceEstimate::runtime() const
+{
+    int workers = std::max(settings.numberOfThreads-1, 1);     // One thread is kept for the boundary
+    return secondsPerCellStep*settings.cellsX*settings.cellsY*settings.steps/workers;
+}
+
+std::string ResourceEstimate::summary() const
+{
+    std::ostringstream s;
+    double MB = 1024*1024;
+    s.precision(1);
+    s << std::fixed;
+    s << "Work buffers:\t" << workBufferBytes/MB << " MB\n";
+    s << "Frames:\t\t" << frameBytes/MB << " MB (" << frames() << " frames, sample distance " << settings.sampleDistance << ")\n";
+    s << "Materials:\t" << materialBytes/MB << " MB\n";
+    s << "Dispersion, SIBC:\t" << auxiliaryBytes/MB << " MB\n";
+    s << "PML:\t\t" << PMLBytes/MB << " MB\n";
+    s << "Subgrids:\t" << subgridBytes/MB << " MB (upper bound)\n";
+    s << "Sensors:\t" << sensorBytes/MB << " MB\n";
+    s << "Total:\t\t" << totalBytes()/MB << " MB\n";
+
+    if(maxFrequency > 0)
+        s << "Highest source frequency " << maxFrequency/1E6 << " MHz, sample distance at most " << nyquistSampleDistance() << "\n";
+
+    if(secondsPerCellStep > 0)
+        s << "Expected runtime of the main grid:\t" << runtime() << " s\n";
+
+    return s.str();
+}
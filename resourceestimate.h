@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RESOURCEESTIMATE_H
+#define RESOURCEESTIMATE_H
+
+#include <vector>
+#include <string>
+#include "settings.h"
+#include "currentsource.h"
+#include "materialdefinition.h"
+#include "planewave.h"
+#include "sensordefinition.h"
+#include "sginterface.h"
+
+class ResourceEstimate
+{
+public:
+    ResourceEstimate(Settings settings, const std::vector<currentSource> &sources, const std::vector<MaterialDefinition> &materials, const std::vector<PlaneWave> &TFSF,
+                     const std::vector<SensorDefinition> &sensors, const std::vector<SGInterface> &hsgSurfaces);
+
+    double workBufferBytes=0, frameBytes=0, materialBytes=0, auxiliaryBytes=0, PMLBytes=0, subgridBytes=0, sensorBytes=0;     // auxiliaryBytes: dispersion and surface impedance
+    double bytesPerFrame=0;             // Main grid and subgrids together, this is what sampleDistance scales
+    double maxFrequency=0;              // Highest frequency with significant content in any of the sources [Hz]
+    double secondsPerCellStep=0;        // Measured by calibrate(), 0 if not calibrated
+    Settings settings;
+
+    double totalBytes() const;
+    int nyquistSampleDistance() const;                  // Largest sample distance which still resolves maxFrequency
+    int fitSampleDistance(double budget) const;         // Smallest sample distance for which everything fits in budget bytes, 0 if impossible
+    void setSampleDistance(int sampleDistance);
+    void calibrate(int calibrationSteps=10);            // Time a few single threaded steps of the main grid
+    double runtime() const;                             // Expected wall clock time of the main grid [s]
+    std::string summary() const;
+
+private:
+    std::vector<PlaneWave> TFSF;
+    double subgridFrameBytes=0;
+    int frames() const;
+};
+
+#endif // RESOURCEESTIMATE_H
@@ -31,6 +31,9 @@ SensorDefinition& SensorDefinition::operator=(const SensorDefinition& a)
     this->Ex = a.Ex;
     this->Ey = a.Ey;
     this->Hz = a.Hz;
+    this->fEx = a.fEx;          // The spectra are shared like the samples, or a copy keeps pointing at freed ones
+    this->fEy = a.fEy;
+    this->fHz = a.fHz;
     this->index = a.index;
     this->size = a.size;
     this->dt = a.dt;
@@ -52,9 +55,39 @@ void SensorDefinition::initVariables(Settings settings)
     Ey = new double[settings.steps];//    Ey[0] = 0; Ey[1] = 0;
     Hz = new double[settings.steps];//    Hz[0] = 0; Hz[1] = 0;
 
-    fEx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * settings.steps/2+1);
-    fEy = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * settings.steps/2+1);
-    fHz = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * settings.steps/2+1);
+    fEx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));
+    fEy = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));
+    fHz = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));
+}
+
+void SensorDefinition::extendVariables(Settings settings)
+{
+    if(size == 0) {         // Sensor was added after the run, it only records from here on
+        settings.computeDifferentials();
+        i = xpos/settings.dx+settings.cellsX/2.0+settings.PMLlayers;
+        j = ypos/settings.dy+settings.cellsY/2.0+settings.PMLlayers;
+        dt = settings.dt;
+    }
+
+    double *newEx = new double[settings.steps];
+    double *newEy = new double[settings.steps];
+    double *newHz = new double[settings.steps];
+
+    for(int n=0; n<settings.steps; n++) {
+        newEx[n] = n < size ? Ex[n] : 0;
+        newEy[n] = n < size ? Ey[n] : 0;
+        newHz[n] = n < size ? Hz[n] : 0;
+    }
+
+    deleteVariables();
+    Ex = newEx;
+    Ey = newEy;
+    Hz = newHz;
+    size = settings.steps;
+
+    fEx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));     // The spectra are recomputed in SensorResult anyway
+    fEy = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));
+    fHz = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (settings.steps/2+1));
 }
 
 void SensorDefinition::deleteVariables()
@@ -29,6 +29,7 @@ public:
     SensorDefinition();
     SensorDefinition& operator=(const SensorDefinition& a);
     void initVariables(Settings settings);
+    void extendVariables(Settings settings);        // Grow the arrays to settings.steps, keeping the recorded samples
     void deleteVariables();
 
     bool phasePlotted=false, magnitudePlotted=false, timePlotted=false;
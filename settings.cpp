@@ -49,6 +49,7 @@ Settings& Settings::operator=(const Settings& a){
     this->dy = a.dy;
     this->dt = a.dt;
     this->drawNthField = a.drawNthField;
+    this->memoryBudget = a.memoryBudget;
     return *this;
 }
 
@@ -31,6 +31,7 @@ public:
     int sampleDistance=1;
     double width=240, height=180;
     int drawNthField=0;
+    int memoryBudget=4096;          // [MB] Start warns when the resource estimate exceeds this
 
     Settings();
     Settings& operator=(const Settings& a);
@@ -16,8 +16,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include "SGField.h"
+#include "sgfield.h"
 #include <ctime>
+#include <algorithm>
 #include <iostream>
 
 #define c           299792458
@@ -26,6 +27,16 @@
 
 using namespace Eigen;
 
+static const int parallelGrain = 25000;    // Unknowns per block of a loop that is split over the workers, smaller blocks cost more to hand out than they save
+
+template<typename Body> void SGField::parallelFor(int count, int grain, Body body)
+{
+    if(sync != NULL)
+        sync->parallelFor(count, grain, body);
+    else
+        body(0, count);
+}
+
 SGField::SGField(int xRatio, int yRatio, Settings settings, Point pA, Point pB, int sizeWorkBuffer)
 {
     this->xRatio = xRatio;
@@ -60,12 +71,6 @@ SGField::SGField(int xRatio, int yRatio, Settings settings, Point pA, Point pB,
     A = SparseMatrix<double>(sizeEx+sizeEy+sizeHz, sizeEx+sizeEy+sizeHz);
     B = SparseMatrix<double>(sizeEx+sizeEy+sizeHz, sizeEx+sizeEy+sizeHz);
     C = SparseMatrix<double>(sizeEx+sizeEy+sizeHz, sizeEx+sizeEy+sizeHz);
-    A.reserve(VectorXi::Constant(sizeEx+sizeEy+sizeHz,5));
-    B.reserve(VectorXi::Constant(sizeEx+sizeEy+sizeHz,5));
-    C.reserve(VectorXi::Constant(sizeEx+sizeEy+sizeHz,5));
-//    A.reserve(3*sizeEx+3*sizeEy+5*sizeHz);
-//    B.reserve(3*sizeEx+3*sizeEy+sizeHz);
-//    C.reserve(2*sizeEx+2*sizeEy);
     materialParameter = VectorXd(sizeEx+sizeEy+sizeHz);
     conductivity = VectorXd(sizeEx+sizeEy);
 
@@ -78,7 +83,7 @@ SGField::SGField(int xRatio, int yRatio, Settings settings, Point pA, Point pB,
     for(int i=0; i<sizeEx+sizeEy; i++)
         conductivity(i) = 0;
 
-    qDebug() << cellsX << cellsY << sizeExx << sizeExy << sizeEyx << sizeEyy << sizeHzx << sizeHzy << sizeHz+sizeEx+sizeEy;
+//    qDebug() << cellsX << cellsY << sizeExx << sizeExy << sizeEyx << sizeEyy << sizeHzx << sizeHzy << sizeHz+sizeEx+sizeEy;
 //    qDebug() << indexHz(0,0) << indexHz(sizeHzx-1, sizeHzy-1)
 //             << indexEx(0,0) << indexEx(sizeExx-1, sizeExy-1)
 //             << indexEy(0,0) << indexEy(sizeEyx-1, sizeEyy-1);
@@ -124,6 +129,13 @@ double SGField::Hz(int n, int i, int j)
     return (*WBf[n])(indexHz(i, j));
 }
 
+const double *SGField::boundaryHz(int n)
+{
+    if(solverType == Explicit)
+        return hzFiltered.data();       // Only valid for the last step, which is the only one the main grid asks for
+    return WBf[n]->data();
+}
+
 int SGField::indexHz(int i, int j)
 {
     return i + j*sizeHzx;
@@ -139,7 +151,91 @@ int SGField::indexEy(int i, int j)
     return sizeHz + sizeEx + i + j*sizeEyx;
 }
 
-void SGField::initUpdateMatrices(const std::vector<MaterialDefinition> &material)
+void SGField::assembleRow(int r, std::vector<Triplet<double> > &tA, std::vector<Triplet<double> > &tB, std::vector<Triplet<double> > &tC)
+{
+    if(r < sizeExy) {
+        int j = r;
+        double factor = 1;
+        if(j==0 || j==sizeExy-1)
+            factor = 0.5*(1+yRatio);
+
+        for(int i=0; i<sizeExx; i++) {
+            double loss = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt);
+            tA.push_back(Triplet<double>(indexEx(i, j), indexEx(i, j), 1));
+            tB.push_back(Triplet<double>(indexEx(i, j), indexEx(i, j), std::isinf(epsU(i, j)) ? 1 : (2*epsU(i, j) - sigmaU(i, j)*dt)/(2*epsU(i, j) + sigmaU(i, j)*dt)));      // A conductor keeps its E
+
+            tA.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j+1), -loss/(4*dy*factor)));
+            tB.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j+1), loss/(2*dy*factor)));
+            tC.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j+1), loss/(4*dy*factor)));
+
+            tA.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j), loss/(4*dy*factor)));
+            tB.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j), -loss/(2*dy*factor)));
+            tC.push_back(Triplet<double>(indexEx(i, j), indexHz(i, j), -loss/(4*dy*factor)));
+        }
+    }
+    else if(r < sizeExy+sizeEyy) {
+        int j = r - sizeExy;
+        for(int i=0; i<sizeEyx; i++) {
+            double factor = 1;
+            if(i==0 || i==sizeEyx-1)
+                factor = 0.5*(1+xRatio);
+
+            double loss = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt);
+            tA.push_back(Triplet<double>(indexEy(i, j), indexEy(i, j), 1));
+            tB.push_back(Triplet<double>(indexEy(i, j), indexEy(i, j), std::isinf(epsR(i, j)) ? 1 : (2*epsR(i, j) - sigmaR(i, j)*dt)/(2*epsR(i, j) + sigmaR(i, j)*dt)));
+
+            tA.push_back(Triplet<double>(indexEy(i, j), indexHz(i+1, j), loss/(4*dx*factor)));
+            tB.push_back(Triplet<double>(indexEy(i, j), indexHz(i+1, j), -loss/(2*dx*factor)));
+            tC.push_back(Triplet<double>(indexEy(i, j), indexHz(i+1, j), -loss/(4*dx*factor)));
+
+            tA.push_back(Triplet<double>(indexEy(i, j), indexHz(i, j), -loss/(4*dx*factor)));
+            tB.push_back(Triplet<double>(indexEy(i, j), indexHz(i, j), loss/(2*dx*factor)));
+            tC.push_back(Triplet<double>(indexEy(i, j), indexHz(i, j), loss/(4*dx*factor)));
+        }
+    }
+    else {
+        int j = r - sizeExy - sizeEyy;
+        for(int i=0; i<sizeHzx; i++) {
+            double factor;
+
+            tA.push_back(Triplet<double>(indexHz(i, j), indexHz(i, j), 1));
+            tB.push_back(Triplet<double>(indexHz(i, j), indexHz(i, j), 1));
+
+            if(j==0 || j==sizeHzy-1)
+                factor = yRatio;
+            else
+                factor = 1;
+            if(j < sizeExy)
+                tA.push_back(Triplet<double>(indexHz(i, j), indexEx(i, j), -dt/(muC(i, j)*dy*factor)));
+            if(j > 0)
+                tA.push_back(Triplet<double>(indexHz(i, j), indexEx(i, j-1), dt/(muC(i, j)*dy*factor)));
+
+            if(i==0 || i==sizeHzx-1)
+                factor = xRatio;
+            else
+                factor = 1;
+            if(i < sizeEyx)
+                tA.push_back(Triplet<double>(indexHz(i, j), indexEy(i, j), dt/(muC(i, j)*dx*factor)));
+            if(i > 0)
+                tA.push_back(Triplet<double>(indexHz(i, j), indexEy(i-1, j), -dt/(muC(i, j)*dx*factor)));
+        }
+    }
+}
+
+void SGField::setFromRows(SparseMatrix<double> &M, const std::vector<std::vector<Triplet<double> > > &rows)
+{
+    int size = 0;
+    for(int r=0; r<(int)rows.size(); r++)
+        size += rows[r].size();
+
+    std::vector<Triplet<double> > triplets;
+    triplets.reserve(size);
+    for(int r=0; r<(int)rows.size(); r++)
+        triplets.insert(triplets.end(), rows[r].begin(), rows[r].end());
+    M.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+void SGField::initUpdateMatrices(const MaterialIndex &index)
 {
     if(WBf != NULL) {
         for(int i=0; i<sizeWorkBuffer; i++)
@@ -156,130 +252,446 @@ void SGField::initUpdateMatrices(const std::vector<MaterialDefinition> &material
     settings.computeDifferentials();
     this->dt = settings.dt;
 
-    for(int k=0; k<material.size(); k++) {
-        pointInPolygon p;
-        std::vector<Point> points;      // To prevent out of scope
-        if(material[k].p.size() == 2)
-        {
-            points.push_back(Point(material[k].p[0].x, material[k].p[0].y));
-            points.push_back(Point(material[k].p[0].x, material[k].p[1].y));
-            points.push_back(Point(material[k].p[1].x, material[k].p[1].y));
-            points.push_back(Point(material[k].p[1].x, material[k].p[0].y));
-            p.vertices = &points;
-        }
-        else
-            p.vertices = &(material[k].p);
+    // Every material is rasterised a fine row at a time, later materials overwrite earlier ones
+    std::vector<double> xHz(sizeHzx), xEy(sizeHzx);        // x of the Hz (and Ex) and of the Ey samples
+    for(int i=0; i<sizeHzx; i++) {
+        xHz[i] = bottomLeft.x + settings.dx/2 + (i+(xRatio-1)/2.0)*dx;
+        xEy[i] = xHz[i]+dx/2.0;
+    }
 
-        for(int i=0; i<sizeHzx; i++) {
-            for(int j=0; j<sizeHzy; j++) {
-                double testX = bottomLeft.x + settings.dx/2 + (i+(xRatio-1)/2.0)*dx;
-                double testY = bottomLeft.y + settings.dy/2 + (j+(yRatio-1)/2.0)*dy;
+    double firstY = bottomLeft.y + settings.dy/2 + (yRatio-1)/2.0*dy;      // y of the Hz (and Ey) samples of row 0
+    std::vector<int> near;
+    index.query(xHz[0], firstY, xEy[sizeHzx-1], firstY + (sizeHzy-0.5)*dy, near);
+
+    for(int n=0; n<(int)near.size(); n++) {
+        int k = near[n];
+        const MaterialDefinition &material = (*index.materials)[k];
+        pointInPolygon p;
+        p.vertices = &index.polygons[k];
+        double eps = material.PEC == true ? INFINITY : material.epsr*epsilon0;      // A conductor keeps E where it starts, at zero
+        double sigma = material.PEC == true ? 0 : material.sigma;
 
-                if(p.inPolygon(testX, testY))
-                    materialParameter(indexHz(i, j)) = material[k].mur*mu0;
+        int jFirst = std::max((int)floor((index.yMin[k] - firstY)/dy) - 1, 0);    // Only the rows with samples in the bounding box
+        int jLast = std::min((int)ceil((index.yMax[k] - firstY)/dy) + 1, sizeHzy-1);
 
-                if(i < sizeHzx-1 && p.inPolygon(testX+dx/2.0, testY)) {
-                    materialParameter(indexEy(i, j)) = material[k].epsr*epsilon0;
-                    conductivity(indexEy(i, j) - sizeHz) = material[k].sigma;
+        // Rows only write their own samples, large subgrids share them with the workers
+        parallelFor(jLast-jFirst+1, std::max(parallelGrain/sizeHzx, 1), [&](int first, int last) {
+            for(int j=jFirst+first; j<jFirst+last; j++) {
+                double testY = bottomLeft.y + settings.dy/2 + (j+(yRatio-1)/2.0)*dy;
+                std::vector<int> span;
+
+                p.spans(xHz, testY, span);
+                for(int m=0; m+1<(int)span.size(); m+=2)
+                    for(int i=span[m]; i<span[m+1]; i++)
+                        materialParameter(indexHz(i, j)) = material.mur*mu0;
+
+                p.spans(xEy, testY, span);
+                for(int m=0; m+1<(int)span.size(); m+=2) {
+                    for(int i=span[m]; i<std::min(span[m+1], sizeHzx-1); i++) {
+                        materialParameter(indexEy(i, j)) = eps;
+                        conductivity(indexEy(i, j) - sizeHz) = sigma;
+                    }
                 }
 
-                if(j < sizeHzy-1 && p.inPolygon(testX, testY+dy/2.0)) {
-                    materialParameter(indexEx(i, j)) = material[k].epsr*epsilon0;
-                    conductivity(indexEx(i, j) - sizeHz) = material[k].sigma;
+                if(j == sizeHzy-1)
+                    continue;
+                p.spans(xHz, testY+dy/2.0, span);
+                for(int m=0; m+1<(int)span.size(); m+=2) {
+                    for(int i=span[m]; i<span[m+1]; i++) {
+                        materialParameter(indexEx(i, j)) = eps;
+                        conductivity(indexEx(i, j) - sizeHz) = sigma;
+                    }
                 }
             }
-        }
+        });
     }
 
-    // Initialize update matrices
-    for(int i=0; i<sizeExx; i++) {
-        for(int j=0; j<sizeExy; j++) {
-            double factor = 1;
-            if(j==0 || j==sizeExy-1)
-                factor = 0.5*(1+yRatio);
+    // Initialize update matrices, every grid row of Ex, Ey and Hz collects its own triplets so the rows are filled in parallel
+    int rows = sizeExy + sizeEyy + sizeHzy;
+    std::vector<std::vector<Triplet<double> > > tripletsA(rows), tripletsB(rows), tripletsC(rows);
+    parallelFor(rows, std::max(parallelGrain/sizeHzx, 1), [&](int first, int last) {
+        for(int r=first; r<last; r++)
+            assembleRow(r, tripletsA[r], tripletsB[r], tripletsC[r]);
+    });
+
+    setFromRows(A, tripletsA);
+    setFromRows(B, tripletsB);
+    setFromRows(C, tripletsC);
+
+//    qDebug() << "Matrix rank: " << A.rows();
+    A.makeCompressed();
+
+    s = VectorXd::Zero(sizeEx+sizeEy+sizeHz);
+    WBf = new VectorXd*[sizeWorkBuffer];
+    for(int n=0; n<sizeWorkBuffer; n++) {
+        WBf[n] = new VectorXd(sizeEx+sizeEy+sizeHz);
+        WBf[n]->setZero(sizeEx+sizeEy+sizeHz);
+    }
+
+    OBf = new VectorXd*[(int)std::ceil((double)settings.steps/settings.sampleDistance)];
+    for(int n=0; n<std::ceil((double)settings.steps/settings.sampleDistance); n++)
+        OBf[n] = new VectorXd(sizeEx+sizeEy+sizeHz);
+
+    BR = B;
+    CR = C;
+    BR.makeCompressed();
+    CR.makeCompressed();
+    rhs = VectorXd::Zero(sizeEx+sizeEy+sizeHz);
+    rhsH = VectorXd::Zero(sizeHz);
+
+    if(solverType == Explicit)
+        initExplicit();
 
-            A.insert(indexEx(i, j), indexEx(i, j)) = 1;
-            B.insert(indexEx(i, j), indexEx(i, j)) = (2*epsU(i, j) - sigmaU(i, j)*dt)/(2*epsU(i, j) + sigmaU(i, j)*dt);
+    if(solverType == ADI)
+        initADI();
 
-//            B.insert(indexEx(i, j), indexHz(i, j)) = -2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(dy*factor);        // unconditional stability
-//            B.insert(indexEx(i, j), indexHz(i, j+1)) = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(dy*factor);       // along x
-            A.insert(indexEx(i, j), indexHz(i, j+1)) = -2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(4*dy*factor);
-            B.insert(indexEx(i, j), indexHz(i, j+1)) = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(2*dy*factor);
-            C.insert(indexEx(i, j), indexHz(i, j+1)) = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(4*dy*factor);
+    if(solverType == Schur && !initSchur())
+        solverType = DirectLU;
 
-            A.insert(indexEx(i, j), indexHz(i, j)) = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(4*dy*factor);
-            B.insert(indexEx(i, j), indexHz(i, j)) = -2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(2*dy*factor);
-            C.insert(indexEx(i, j), indexHz(i, j)) = -2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(4*dy*factor);
+    if(solverType == DirectLU) {
+        lu.analyzePattern(A);       // Fill reducing ordering
+        lu.factorize(A);
+        if(lu.info() != Success)
+            solverType = Iterative;             // Fall back to BiCGSTAB
+    }
+
+    if(solverType == Iterative) {
+        solver.preconditioner().setDroptol(1E-50);
+        solver.preconditioner().setFillfactor(sqrt(xRatio*yRatio)+50);
+        solver.compute(A);
+        solver.setMaxIterations(static_cast<int>(1000));
+        solver.setTolerance(tolerance);
+    }
+
+    solverIterations.assign(settings.steps, 0);
+    solverResidual.assign(settings.steps, 0);
+}
+
+bool SGField::initSchur()
+{
+    int size = sizeEx+sizeEy;
+    F = A.block(0, sizeHz, sizeHz, size);
+    G = A.block(sizeHz, 0, size, sizeHz);
+
+    SparseMatrix<double> I(sizeHz, sizeHz);
+    I.setIdentity();
+    SparseMatrix<double> S = I - F*G;
+    S.makeCompressed();
+
+    // The interface weights make S unsymmetric, but D*S is symmetric for a diagonal D
+    // Walk over the graph of S and choose D(k) so that D(h)*S(h,k) = D(k)*S(k,h)
+    SparseMatrix<double> St = S.transpose();
+    schurScale = VectorXd::Zero(sizeHz);
+    std::vector<int> queue;
+    for(int start=0; start<sizeHz; start++) {
+        if(schurScale(start) != 0)
+            continue;
+        schurScale(start) = 1;
+        queue.push_back(start);
+        for(int q=queue.size()-1; q<(int)queue.size(); q++) {
+            int h = queue[q];
+            for(SparseMatrix<double>::InnerIterator it(St, h); it; ++it) {     // Column h of St is row h of S
+                int k = it.row();
+                if(k == h || schurScale(k) != 0)
+                    continue;
+                schurScale(k) = schurScale(h)*it.value()/S.coeff(k, h);
+                queue.push_back(k);
+            }
         }
     }
 
-    for(int i=0; i<sizeEyx; i++) {
-        for(int j=0; j<sizeEyy; j++) {
-            double factor = 1;
-            if(i==0 || i==sizeEyx-1)
-                factor = 0.5*(1+xRatio);
+    SparseMatrix<double> M = schurScale.asDiagonal()*S;
+    SparseMatrix<double> Mt = M.transpose();
+    schurSymmetric = (schurScale.minCoeff() > 0) && (M - Mt).norm() <= 1E-12*M.norm();
+
+    if(schurSymmetric) {
+        cholesky.compute(M);
+        if(cholesky.info() == Success)
+            return true;
+        schurSymmetric = false;
+    }
+
+    lu.analyzePattern(S);
+    lu.factorize(S);
+    return lu.info() == Success;
+}
+
+void SGField::initADI()
+{
+    F = A.block(0, sizeHz, sizeHz, sizeEx+sizeEy);
+    G = A.block(sizeHz, 0, sizeEx+sizeEy, sizeHz);
+
+    SparseMatrix<double> Ly = -SparseMatrix<double>(F.leftCols(sizeEx))*SparseMatrix<double>(G.topRows(sizeEx));        // Ex couples Hz(i, j) and Hz(i, j+1)
+    SparseMatrix<double> Lx = -SparseMatrix<double>(F.rightCols(sizeEy))*SparseMatrix<double>(G.bottomRows(sizeEy));    // Ey couples Hz(i, j) and Hz(i+1, j)
+
+    std::vector<double> diagX(sizeHz, 1), diagY(sizeHz, 1);
+    lowerX.assign(sizeHz, 0); upperX.assign(sizeHz, 0);
+    lowerY.assign(sizeHz, 0); upperY.assign(sizeHz, 0);
+
+    for(int k=0; k<Lx.outerSize(); k++) {
+        for(SparseMatrix<double>::InnerIterator it(Lx, k); it; ++it) {
+            if(it.row() == it.col())
+                diagX[it.row()] += it.value();
+            else if(it.col() == it.row()-1)
+                lowerX[it.row()] = it.value();
+            else if(it.col() == it.row()+1)
+                upperX[it.row()] = it.value();
+        }
+    }
 
-            A.insert(indexEy(i, j), indexEy(i, j)) = 1;
-            B.insert(indexEy(i, j), indexEy(i, j)) = (2*epsR(i, j) - sigmaR(i, j)*dt)/(2*epsR(i, j) + sigmaR(i, j)*dt);
+    for(int k=0; k<Ly.outerSize(); k++) {
+        for(SparseMatrix<double>::InnerIterator it(Ly, k); it; ++it) {
+            if(it.row() == it.col())
+                diagY[it.row()] += it.value();
+            else if(it.col() == it.row()-sizeHzx)
+                lowerY[it.row()] = it.value();
+            else if(it.col() == it.row()+sizeHzx)
+                upperY[it.row()] = it.value();
+        }
+    }
 
-//            B.insert(indexEy(i, j), indexHz(i+1, j)) = -2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(dx*factor);
-//            B.insert(indexEy(i, j), indexHz(i, j)) = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(dx*factor);
-            A.insert(indexEy(i, j), indexHz(i+1, j)) = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(4*dx*factor);
-            B.insert(indexEy(i, j), indexHz(i+1, j)) = -2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(2*dx*factor);
-            C.insert(indexEy(i, j), indexHz(i+1, j)) = -2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(4*dx*factor);
+    diagS.resize(sizeHz);
+    for(int h=0; h<sizeHz; h++)
+        diagS[h] = diagX[h] + diagY[h] - 1;
 
-            A.insert(indexEy(i, j), indexHz(i, j)) = -2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(4*dx*factor);
-            B.insert(indexEy(i, j), indexHz(i, j)) = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(2*dx*factor);
-            C.insert(indexEy(i, j), indexHz(i, j)) = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(4*dx*factor);
+    // Forward elimination of the Thomas algorithm, the matrices are constant so this is done once
+    factorX.assign(sizeHz, 0); denomX.assign(sizeHz, 0);
+    for(int j=0; j<sizeHzy; j++) {
+        for(int i=0; i<sizeHzx; i++) {
+            int h = indexHz(i, j);
+            denomX[h] = 1/(diagX[h] - (i > 0 ? lowerX[h]*factorX[h-1] : 0));
+            factorX[h] = upperX[h]*denomX[h];
         }
     }
 
+    factorY.assign(sizeHz, 0); denomY.assign(sizeHz, 0);
     for(int i=0; i<sizeHzx; i++) {
         for(int j=0; j<sizeHzy; j++) {
-            double factor;
+            int h = indexHz(i, j);
+            denomY[h] = 1/(diagY[h] - (j > 0 ? lowerY[h]*factorY[h-sizeHzx] : 0));
+            factorY[h] = upperY[h]*denomY[h];
+        }
+    }
 
-            A.insert(indexHz(i, j), indexHz(i, j)) = 1;
-            B.insert(indexHz(i, j), indexHz(i, j)) = 1;
+    for(VectorXd *v : {&adiR, &adiR0, &adiP, &adiV, &adiS, &adiT})
+        v->setZero(sizeHz);
+}
 
-            if(j==0 || j==sizeHzy-1)
-                factor = yRatio;
-            else
-                factor = 1;
-            if(j < sizeExy)
-                A.insert(indexHz(i, j), indexEx(i, j)) = -dt/(muC(i, j)*dy*factor);
-            if(j > 0)
-                A.insert(indexHz(i, j), indexEx(i, j-1)) = dt/(muC(i, j)*dy*factor);
+void SGField::sweepADI(double *x)
+{
+    // Rows and column blocks are independent, large subgrids share them with the workers
+    parallelFor(sizeHzy, std::max(parallelGrain/sizeHzx, 1), [&](int first, int last) {
+        for(int j=first; j<last; j++) {             // (I + Lx), every row is independent
+            int h0 = indexHz(0, j);
+            x[h0] *= denomX[h0];
+            for(int h=h0+1; h<h0+sizeHzx; h++)
+                x[h] = (x[h] - lowerX[h]*x[h-1])*denomX[h];
+            for(int h=h0+sizeHzx-2; h>=h0; h--)
+                x[h] -= factorX[h]*x[h+1];
+        }
+    });
+
+    // The columns are swept together, a row at a time, so the memory is accessed in order
+    const int block = 64;
+    int blocks = (sizeHzx+block-1)/block;
+    parallelFor(blocks, std::max(parallelGrain/(block*sizeHzy), 1), [&](int first, int last) {
+        for(int b=first; b<last; b++) {             // (I + Ly), every column is independent
+            int i0 = b*block, i1 = std::min(i0+block, sizeHzx);
+            for(int i=i0; i<i1; i++)
+                x[i] *= denomY[i];
+            for(int j=1; j<sizeHzy; j++) {
+                for(int h=indexHz(i0, j); h<indexHz(i1, j); h++)
+                    x[h] = (x[h] - lowerY[h]*x[h-sizeHzx])*denomY[h];
+            }
+            for(int j=sizeHzy-2; j>=0; j--) {
+                for(int h=indexHz(i0, j); h<indexHz(i1, j); h++)
+                    x[h] -= factorY[h]*x[h+sizeHzx];
+            }
+        }
+    });
+}
 
-            if(i==0 || i==sizeHzx-1)
-                factor = xRatio;
-            else
-                factor = 1;
-            if(i < sizeEyx)
-                A.insert(indexHz(i, j), indexEy(i, j)) = dt/(muC(i, j)*dx*factor);
-            if(i > 0)
-                A.insert(indexHz(i, j), indexEy(i-1, j)) = -dt/(muC(i, j)*dx*factor);
+void SGField::applyS(const double *x, double *y)
+{
+    parallelFor(sizeHzy, std::max(parallelGrain/sizeHzx, 1), [&](int first, int last) {
+        for(int j=first; j<last; j++) {
+            for(int i=0; i<sizeHzx; i++) {
+                int h = indexHz(i, j);
+                double Sx = diagS[h]*x[h];
+                if(i > 0) Sx += lowerX[h]*x[h-1];
+                if(i < sizeHzx-1) Sx += upperX[h]*x[h+1];
+                if(j > 0) Sx += lowerY[h]*x[h-sizeHzx];
+                if(j < sizeHzy-1) Sx += upperY[h]*x[h+sizeHzx];
+                y[h] = Sx;
+            }
         }
+    });
+}
+
+int SGField::solveADI(const VectorXd &b, double *xData)
+{
+    Map<VectorXd> x(xData, sizeHz);
+    const double bound = tolerance*tolerance*std::max(b.squaredNorm(), 1E-300);
+
+    applyS(xData, adiR.data());
+    adiR = b - adiR;
+    adiR0 = adiR;
+    adiP.setZero();
+    adiV.setZero();
+    double rho = 1, alpha = 1, omega = 1;
+
+    int k;
+    for(k=0; k<adiMaxIterations && adiR.squaredNorm() > bound; k++) {
+        double rhoNew = adiR0.dot(adiR);
+        if(rhoNew == 0 || omega == 0)
+            break;                                  // Breakdown, keep the last iterate
+        adiP = adiR + (rhoNew/rho)*(alpha/omega)*(adiP - omega*adiV);
+        rho = rhoNew;
+
+        adiT = adiP;                                // adiT holds the preconditioned direction for now
+        sweepADI(adiT.data());
+        applyS(adiT.data(), adiV.data());
+        alpha = rho/adiR0.dot(adiV);
+        x += alpha*adiT;
+        adiS = adiR - alpha*adiV;
+        if(adiS.squaredNorm() <= bound) {
+            adiR = adiS;
+            k++;
+            break;
+        }
+
+        sweepADI(adiS.data());                      // adiS is preconditioned in place, adiR keeps the residual
+        applyS(adiS.data(), adiT.data());
+        adiR -= alpha*adiV;
+        omega = adiT.dot(adiR)/adiT.squaredNorm();
+        x += omega*adiS;
+        adiR -= omega*adiT;
     }
+    return k;
+}
 
-    qDebug() << "Matrix rank: " << A.rows();
-    A.makeCompressed();
+void SGField::initExplicit()
+{
+    // The fine cells see a Courant number of courant*ratio/subSteps, the damping of the local steps costs
+    // a little of the stability limit, so stay under 0.98
+    subSteps = std::max(1, (int)ceil(std::max(xRatio, yRatio)*settings.courant/0.98));
+
+    // Chebyshev polynomials T and U at delta, scaled such that the local steps stay consistent with dt
+    int p = subSteps;
+    double delta = 1 + localDamping/(p*p);
+    std::vector<double> T(p+2), U(p+2);
+    T[0] = 1; T[1] = delta;
+    U[0] = 1; U[1] = 2*delta;
+    for(int m=1; m<=p; m++) {
+        T[m+1] = 2*delta*T[m] - T[m-1];
+        U[m+1] = 2*delta*U[m] - U[m-1];
+    }
+    double scale = p*T[p]/(2*U[p-1]);
+
+    localDecay.assign(p, 0);
+    localGain.assign(p, 0);
+    localGain[0] = scale/delta/p;                       // Zero velocity, so about half a step
+    for(int m=1; m<p; m++) {
+        localDecay[m] = T[m-1]/T[m+1];
+        localGain[m] = 2*scale*T[m]/T[m+1]/p;
+    }
 
-    s = VectorXd::Zero(sizeEx+sizeEy+sizeHz);
-    WBf = new VectorXd*[sizeWorkBuffer];
-    for(int n=0; n<sizeWorkBuffer; n++) {
-        WBf[n] = new VectorXd(sizeEx+sizeEy+sizeHz);
-        WBf[n]->setZero(sizeEx+sizeEy+sizeHz);
+    localWeight.assign(p, 0);                       // What Hz of step l contributes to the sum of E, normalised to 1 in total
+    for(int l=0; l<p; l++) {
+        double product = 1;
+        for(int m=l; m<p; m++) {
+            if(m > l)
+                product *= localDecay[m];
+            localWeight[l] += product;
+        }
+        localWeight[l] *= 2.0*localGain[l]/p;
     }
 
-    OBf = new VectorXd*[(int)std::ceil((double)settings.steps/settings.sampleDistance)];
-    for(int n=0; n<std::ceil((double)settings.steps/settings.sampleDistance); n++)
-        OBf[n] = new VectorXd(sizeEx+sizeEy+sizeHz);
+    explicitE = SparseMatrix<double, RowMajor>(sizeEx+sizeEy, sizeHz);
+    explicitE.reserve(VectorXi::Constant(sizeEx+sizeEy, 2));
+    explicitDecay = VectorXd(sizeEx+sizeEy);
+
+    for(int i=0; i<sizeExx; i++) {
+        for(int j=0; j<sizeExy; j++) {
+            double factor = (j==0 || j==sizeExy-1 ? 0.5*(1+yRatio) : 1);
+            int r = indexEx(i, j) - sizeHz;
+            explicitDecay(r) = std::isinf(epsU(i, j)) ? 1 : (2*epsU(i, j) - sigmaU(i, j)*dt)/(2*epsU(i, j) + sigmaU(i, j)*dt);
+            explicitE.insert(r, indexHz(i, j)) = -2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(dy*factor);
+            explicitE.insert(r, indexHz(i, j+1)) = 2*dt/(2*epsU(i, j) + sigmaU(i, j)*dt)/(dy*factor);
+        }
+    }
 
-    solver.preconditioner().setDroptol(1E-50);
-    solver.preconditioner().setFillfactor(sqrt(xRatio*yRatio)+50);
-    solver.compute(A);
-    solver.setMaxIterations(static_cast<int>(1000));
-    solver.setTolerance(1E-100);
+    for(int i=0; i<sizeEyx; i++) {
+        for(int j=0; j<sizeEyy; j++) {
+            double factor = (i==0 || i==sizeEyx-1 ? 0.5*(1+xRatio) : 1);
+            int r = indexEy(i, j) - sizeHz;
+            explicitDecay(r) = std::isinf(epsR(i, j)) ? 1 : (2*epsR(i, j) - sigmaR(i, j)*dt)/(2*epsR(i, j) + sigmaR(i, j)*dt);
+            explicitE.insert(r, indexHz(i, j)) = 2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(dx*factor);
+            explicitE.insert(r, indexHz(i+1, j)) = -2*dt/(2*epsR(i, j) + sigmaR(i, j)*dt)/(dx*factor);
+        }
+    }
+    explicitE.makeCompressed();
+
+    explicitH = -SparseMatrix<double, RowMajor>(A.block(0, sizeHz, sizeHz, sizeEx+sizeEy));     // The Hz rows of A hold dt*curl(E)
+    explicitH.makeCompressed();
+
+    localField = VectorXd::Zero(sizeEx+sizeEy+sizeHz);
+    localSum = VectorXd::Zero(sizeEx+sizeEy);
+    hzFiltered = VectorXd::Zero(sizeHz);
+}
+
+void SGField::startLocalSteps(int Old)
+{
+    localField.head(sizeHz) = WBf[Old]->head(sizeHz);
+    localField.tail(sizeEx+sizeEy).noalias() = localGain[0]*(explicitE*localField.head(sizeHz));
+    localSum = localField.tail(sizeEx+sizeEy);
+    hzFiltered = localWeight[0]*localField.head(sizeHz);
+}
+
+void SGField::localStepH()
+{
+    const int *outer = explicitH.outerIndexPtr(), *inner = explicitH.innerIndexPtr();
+    const double *value = explicitH.valuePtr(), *source = s.data();
+    const double *E = localField.data() + sizeHz;
+    double *H = localField.data();
+    const double scale = 1.0/subSteps;
+
+    parallelFor(sizeHz, parallelGrain, [&](int first, int last) {
+        for(int h=first; h<last; h++) {
+            double sum = source[h];
+            for(int k=outer[h]; k<outer[h+1]; k++)
+                sum += value[k]*E[inner[k]];
+            H[h] += scale*sum;
+        }
+    });
+}
+
+void SGField::localStepE(int m)
+{
+    const int *outer = explicitE.outerIndexPtr(), *inner = explicitE.innerIndexPtr();
+    const double *value = explicitE.valuePtr();
+    const double *H = localField.data();
+    double *E = localField.data() + sizeHz, *sum = localSum.data(), *filtered = hzFiltered.data();
+    const double decay = localDecay[m], gain = localGain[m], weight = localWeight[m];
+
+    for(int h=0; h<sizeHz; h++)
+        filtered[h] += weight*H[h];
+
+    parallelFor(sizeEx+sizeEy, parallelGrain, [&](int first, int last) {
+        for(int r=first; r<last; r++) {
+            double dE = 0;
+            for(int k=outer[r]; k<outer[r+1]; k++)
+                dE += value[k]*H[inner[k]];
+            E[r] = decay*E[r] + gain*dE;
+            sum[r] += E[r];
+        }
+    });
+}
+
+void SGField::finishLocalSteps(int Old)
+{
+    localSum *= 2.0/subSteps;
+    localSum += explicitDecay.cwiseProduct(WBf[Old]->tail(sizeEx+sizeEy));     // E of the new step
 }
 
 void SGField::transferSample(int n) {
@@ -289,6 +701,40 @@ void SGField::transferSample(int n) {
     std::swap(OBf[OBpos], WBf[WBpos]);
 }
 
+void SGField::extendOutput(int steps)
+{
+    int oldFrames = std::ceil((double)settings.steps/settings.sampleDistance);
+    int newFrames = std::ceil((double)steps/settings.sampleDistance);
+
+    VectorXd **newOBf = new VectorXd*[newFrames];
+    for(int n=0; n<oldFrames; n++)
+        newOBf[n] = OBf[n];
+    for(int n=oldFrames; n<newFrames; n++)
+        newOBf[n] = new VectorXd(VectorXd::Zero(sizeEx+sizeEy+sizeHz));
+
+    delete[] OBf;
+    OBf = newOBf;
+    settings.steps = steps;
+    solverIterations.resize(steps, 0);
+    solverResidual.resize(steps, 0);
+}
+
+void SGField::predictSolution(int n, int size)
+{
+    VectorXd &x = *WBf[n%sizeWorkBuffer];
+    const VectorXd &x1 = *WBf[(n-1+sizeWorkBuffer)%sizeWorkBuffer];
+    const VectorXd &x2 = *WBf[(n-2+sizeWorkBuffer)%sizeWorkBuffer];
+    const VectorXd &x3 = *WBf[(n-3+sizeWorkBuffer)%sizeWorkBuffer];
+
+    int order = std::min(predictorOrder, sizeWorkBuffer-2);        // The oldest step must not be the new one
+    if(order >= 2)
+        x.head(size) = 3*x1.head(size) - 3*x2.head(size) + x3.head(size);
+    else if(order == 1)
+        x.head(size) = 2*x1.head(size) - x2.head(size);
+    else
+        x.head(size) = x1.head(size);
+}
+
 void SGField::updateFields(int n)
 {
     int Old2 = (n-2+sizeWorkBuffer)%sizeWorkBuffer;
@@ -298,38 +744,74 @@ void SGField::updateFields(int n)
     if(n%settings.sampleDistance == 0)
         transferSample(n);                  // Transfer sample from work buffer to output buffer
 
-//    SparseLU<SparseMatrix<double, ColMajor>, COLAMDOrdering<int> > solver;
-//    solver.compute(A);
-
-//    *WBf[New] = solver.solve(B*(*WBf[Old1]) + C*(*WBf[Old2]) + s);
-    *WBf[New] = solver.solveWithGuess(B*(*WBf[Old1]) + C*(*WBf[Old2]) + s, *WBf[Old1]);
-
-//    *WBf[New] = U1*(*WBf[Old1]) + U2*(*WBf[Old2]) + Ainv*s;
-
-//    qDebug() << n << solver.iterations() << solver.error();
-
-    for(int k=sizeHz; k<sizeHz+sizeEx; k++)
-    {
-        if(maxEx < (*WBf[New])(k))
-            maxEx = (*WBf[New])(k);
-        if(minEx > (*WBf[New])(k))
-            minEx = (*WBf[New])(k);
+    if(solverType == Explicit) {
+        WBf[New]->tail(sizeEx+sizeEy) = localSum;          // Set by SGInterface::predictExplicit
+        WBf[New]->head(sizeHz) = WBf[Old1]->head(sizeHz) + s.head(sizeHz);
+        WBf[New]->head(sizeHz).noalias() += explicitH*localSum;
     }
-
-    for(int k=sizeHz+sizeEx; k<sizeHz+sizeEx+sizeEy; k++)
-    {
-        if(maxEy < (*WBf[New])(k))
-            maxEy = (*WBf[New])(k);
-        if(minEy > (*WBf[New])(k))
-            minEy = (*WBf[New])(k);
+    else
+        computeRHS(*WBf[Old1], *WBf[Old2]);
+
+    if(solverType == ADI) {
+        rhsH.noalias() = rhs.head(sizeHz) - F*rhs.tail(sizeEx+sizeEy);
+        predictSolution(n, sizeHz);
+        solverIterations[n] = solveADI(rhsH, WBf[New]->data());        // Hz comes first in the unknowns
+        solverResidual[n] = sqrt(adiR.squaredNorm()/std::max(rhsH.squaredNorm(), 1E-300));
+        WBf[New]->tail(sizeEx+sizeEy) = rhs.tail(sizeEx+sizeEy);
+        WBf[New]->tail(sizeEx+sizeEy).noalias() -= G*WBf[New]->head(sizeHz);      // Back substitution of E
     }
-
-    for(int k=0; k<sizeHz; k++)
-    {
-        if(maxHz < (*WBf[New])(k))
-            maxHz = (*WBf[New])(k);
-        if(minHz > (*WBf[New])(k))
-            minHz = (*WBf[New])(k);
+    else if(solverType == Schur) {
+        rhsH.noalias() = rhs.head(sizeHz) - F*rhs.tail(sizeEx+sizeEy);
+        if(schurSymmetric) {
+            rhsH.array() *= schurScale.array();
+            WBf[New]->head(sizeHz) = cholesky.solve(rhsH);
+        }
+        else
+            WBf[New]->head(sizeHz) = lu.solve(rhsH);
+        WBf[New]->tail(sizeEx+sizeEy) = rhs.tail(sizeEx+sizeEy);
+        WBf[New]->tail(sizeEx+sizeEy).noalias() -= G*WBf[New]->head(sizeHz);      // Back substitution of E
+    }
+    else if(solverType == DirectLU)
+        *WBf[New] = lu.solve(rhs);                  // Only forward and back substitution
+    else if(solverType == Iterative) {
+        if(rhs.squaredNorm() == 0)
+            WBf[New]->setZero();            // BiCGSTAB returns early here without setting its statistics
+        else {
+            predictSolution(n, sizeEx+sizeEy+sizeHz);
+            *WBf[New] = solver.solveWithGuess(rhs, *WBf[New]);
+            solverIterations[n] = solver.iterations();
+            solverResidual[n] = solver.error();
+        }
     }
+
+//    *WBf[New] = U1*(*WBf[Old1]) + U2*(*WBf[Old2]) + Ainv*s;
+
+    maxHz = std::max(maxHz, WBf[New]->segment(0, sizeHz).maxCoeff());          // Vectorised, one pass per component
+    minHz = std::min(minHz, WBf[New]->segment(0, sizeHz).minCoeff());
+    maxEx = std::max(maxEx, WBf[New]->segment(sizeHz, sizeEx).maxCoeff());
+    minEx = std::min(minEx, WBf[New]->segment(sizeHz, sizeEx).minCoeff());
+    maxEy = std::max(maxEy, WBf[New]->segment(sizeHz+sizeEx, sizeEy).maxCoeff());
+    minEy = std::min(minEy, WBf[New]->segment(sizeHz+sizeEx, sizeEy).minCoeff());
     n++;
 }
+
+void SGField::computeRHS(const VectorXd &f1, const VectorXd &f2)
+{
+    const int rows = BR.rows();
+    const int *outerB = BR.outerIndexPtr(), *innerB = BR.innerIndexPtr();
+    const int *outerC = CR.outerIndexPtr(), *innerC = CR.innerIndexPtr();
+    const double *valueB = BR.valuePtr(), *valueC = CR.valuePtr();
+    const double *x1 = f1.data(), *x2 = f2.data(), *source = s.data();
+    double *result = rhs.data();
+
+    parallelFor(rows, parallelGrain, [&](int first, int last) {
+        for(int r=first; r<last; r++) {
+            double sum = source[r];
+            for(int k=outerB[r]; k<outerB[r+1]; k++)
+                sum += valueB[k]*x1[innerB[k]];
+            for(int k=outerC[r]; k<outerC[r+1]; k++)
+                sum += valueC[k]*x2[innerC[k]];
+            result[r] = sum;
+        }
+    });
+}
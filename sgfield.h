@@ -23,29 +23,48 @@
 #include <Eigen/Sparse>
 #include <Eigen/OrderingMethods>
 #include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseLU>
+#include <Eigen/SparseCholesky>
 #include <vector>
-#include <QWaitCondition>
-#include <QMutex>
-#include <QDebug>
 #include <iostream>
 #include "pointinpolygon.h"
 #include "materialdefinition.h"
+#include "materialindex.h"
 #include "settings.h"
+#include "threadsync.h"
 
 using namespace Eigen;
 
-class SGField : public QObject
+class SGField
 {
-    Q_OBJECT
 public:
+    enum SolverType {Iterative=0, DirectLU=1, Schur=2, ADI=3, Explicit=4};
+
     SGField(int xRatio, int yRatio, Settings settings, Point pA, Point pB, int sizeWorkBuffer);
     void initMaterial();
-    void initUpdateMatrices(const std::vector<MaterialDefinition> &material);
+    void initUpdateMatrices(const MaterialIndex &index);
+    void assembleRow(int r, std::vector<Triplet<double> > &tA, std::vector<Triplet<double> > &tB, std::vector<Triplet<double> > &tC);    // Grid row r of Ex, then Ey, then Hz
+    static void setFromRows(SparseMatrix<double> &M, const std::vector<std::vector<Triplet<double> > > &rows);
     void updateFields(int n);
     void transferSample(int n);
+    void extendOutput(int steps);       // Grow OBf to hold the frames up to steps
+    bool initSchur();                   // Eliminate E from A, returns false if the reduced system cannot be factorised
+    void computeRHS(const VectorXd &f1, const VectorXd &f2);     // rhs = B*f1 + C*f2 + s in a single pass
+    template<typename Body> void parallelFor(int count, int grain, Body body);   // body(first, last) over blocks of [0, count), see ThreadSync::parallelFor
+    void initADI();                     // Split I - F*G into the x and y lines and factorise every line
+    void sweepADI(double *x);           // x = (I + Ly)^-1 (I + Lx)^-1 x, one independent tridiagonal solve per row and column
+    void applyS(const double *x, double *y);        // y = (I - F*G) x, matrix-free
+    int solveADI(const VectorXd &b, double *x);     // BiCGSTAB on (I - F*G) x = b preconditioned by sweepADI, returns the iterations
+    void predictSolution(int n, int size);          // Initial guess of an iterative solve, extrapolates the first size unknowns of the last steps
+    void initExplicit();                // Leapfrog coefficients of the local time steps, no system is solved
+    void startLocalSteps(int Old);      // Local time stepping, see SGInterface::predictExplicit
+    void localStepH();
+    void localStepE(int m);
+    void finishLocalSteps(int Old);
     double Ex(int n, int i, int j);     // With correction for separation and padding distance (for plot purposes)
     double Ey(int n, int i, int j);
     double Hz(int n, int i, int j);
+    const double *boundaryHz(int n);    // What the main grid sees of Hz, indexed by indexHz
     int indexEx(int i, int j);
     int indexEy(int i, int j);
     int indexHz(int i, int j);
@@ -64,19 +83,51 @@ public:
     double dx, dy;
     double minEx=0, maxEx=0, minEy=0, maxEy=0, minHz=0, maxHz=0;
     Settings settings;
+    ThreadSync *sync=NULL;                      // Large loops are split over the workers of the engine, serial without it
 //    std::vector<VectorXd> WBf, OBf, s;            // Work buffer fields and output buffer fields
     VectorXd **WBf=NULL, **OBf=NULL;            // Work buffer fields and output buffer fields
     VectorXd s;
     SparseMatrix<double, ColMajor> A, B, C;
+    SparseMatrix<double, RowMajor> BR, CR;      // Row major copies of B and C, so every row of the RHS is computed independently
     MatrixXd Ainv, U1, U2;                     // Af(n+1) = Bf(n) + s, s=sources, U = update matrix (=Ainv*B)
     VectorXd materialParameter, conductivity;
     Eigen::BiCGSTAB<SparseMatrix<double>, Eigen::IncompleteLUT<double> > solver;
-    double dt;
+    Eigen::SparseLU<SparseMatrix<double>, Eigen::COLAMDOrdering<int> > lu;     // A is constant, so it is factorised once
+    int solverType=DirectLU;                    // Set before initUpdateMatrices
+    double tolerance=1E-6;                      // Residual of the iterative solvers relative to the right hand side
+    int predictorOrder=1;                       // Extrapolation of the initial guess, 0 = last step, 1 = linear, 2 = quadratic
+    std::vector<int> solverIterations;          // Per step, only for Iterative and ADI
+    std::vector<double> solverResidual;         // Per step, relative to the right hand side
+
+    // Schur complement: the E rows of A are [G I], so E = rhsE - G*Hz and (I - F*G)*Hz = rhsH - F*rhsE
+    SparseMatrix<double> F, G;                  // F: Hz rows, E columns of A, G: E rows, Hz columns
+    VectorXd schurScale;                        // Diagonal D which makes D*(I - F*G) symmetric
+    Eigen::SimplicialLDLT<SparseMatrix<double> > cholesky;
+    bool schurSymmetric=false;                  // Otherwise lu holds the factorisation of I - F*G
+    VectorXd rhs, rhsH;                         // Allocated once, reused every step
 
-signals:
-    void finished();
-    void updateGUI(double, double, double, double, double, double);
-    void fieldUpdateFinished(int n);
+    // ADI: I - F*G = I + Lx + Ly, where Lx only couples Hz along x and Ly along y. (I + Lx)(I + Ly) only
+    // differs by Lx*Ly, which makes it a good preconditioner that is solved with tridiagonal solves only
+    std::vector<double> diagS, lowerX, upperX, lowerY, upperY;     // I - F*G as a 5-point stencil
+    std::vector<double> factorX, denomX, factorY, denomY;          // Thomas algorithm, factorised once (denom holds the inverse)
+    VectorXd adiR, adiR0, adiP, adiV, adiS, adiT;                   // BiCGSTAB work vectors, allocated once
+    int adiMaxIterations=100;
+
+    // Explicit: leapfrog with local time steps (Diaz and Grote). Per coarse step the subgrid takes subSteps
+    // steps of dt/subSteps from Hz with zero velocity, the main grid around it is frozen. The sum of
+    // these steps gives E, after which Hz takes a single step of dt like in the main grid. The local steps
+    // follow a Chebyshev recursion damped by localDamping (stabilised LTS-LF, Grote, Mehlin and Sauter),
+    // plain leapfrog local steps resonate and grow for some Courant numbers. The coarse fields around the
+    // subgrid are deliberately not interpolated in time during the local steps, with this coupling that was
+    // unstable, so they stay frozen at the last coarse step. The row loops share the workers of the engine.
+    SparseMatrix<double, RowMajor> explicitE, explicitH;       // E rows, Hz columns and Hz rows, E columns, both for dt
+    VectorXd explicitDecay;                                     // Loss factor of E
+    VectorXd localField, localSum;                              // State of the local steps, sum of their E
+    VectorXd hzFiltered;                                        // Hz weighted over the local steps, used by the main grid
+    std::vector<double> localDecay, localGain, localWeight;     // Per local step: E = decay*E + gain*curl(Hz), weight of Hz in hzFiltered
+    double localDamping=0.01;
+    int subSteps=1;
+    double dt;
 };
 
 #endif // SGField_H
@@ -30,8 +30,21 @@ SGInterface& SGInterface::operator=(const SGInterface& a)
     this->index = a.index;
     this->xRatio = a.xRatio;
     this->yRatio = a.yRatio;
+    this->solverType = a.solverType;
+    this->tolerance = a.tolerance;
     this->FA = a.FA;
     this->FB = a.FB;
+    this->slotE = a.slotE;
+    this->slotInside = a.slotInside;
+    this->slotOutside = a.slotOutside;
+    this->slotWeight = a.slotWeight;
+    this->slotsEx = a.slotsEx;
+    this->toMain = a.toMain;
+    this->toSubgrid = a.toSubgrid;
+    this->interfaceE = a.interfaceE;
+    this->frozenHz = a.frozenHz;
+    this->localE = a.localE;
+    return *this;
 }
 
 void SGInterface::advanceE(int n)
@@ -39,67 +52,133 @@ void SGInterface::advanceE(int n)
     int Old = (n-1+sizeWorkBuffer)%sizeWorkBuffer;      // Old time
     int New = n%sizeWorkBuffer;                         // New time
 
-    // Correct wrongful E update, first set the wrong terms to 0
-    for(int i=iMin; i<iMin+FB->cellsX; i++) {
-        int j = jMin-1;
-        double C = FA->sigmaU[i][j]*dt/(2*FA->epsU[i][j]);
-        FA->WBEx[New][i][j] = (1-C)/(1+C)*FA->WBEx[Old][i][j] + dt/FA->epsU[i][j]/(1+C)*((0 - FA->WBHz[Old][i][j])/dy);     // Bottom
-
-        j = jMax;
-        C = FA->sigmaU[i][j]*dt/(2*FA->epsU[i][j]);
-        FA->WBEx[New][i][j] = (1-C)/(1+C)*FA->WBEx[Old][i][j] + dt/FA->epsU[i][j]/(1+C)*((FA->WBHz[Old][i][j+1] - 0)/dy);   // Top
+    if(FB->solverType == SGField::Explicit)
+        predictExplicit(n);                             // Gives the E of FB and the Hz that the main grid sees
+
+    double *Ex = FA->WBEx[New][0], *Ey = FA->WBEy[New][0];
+    const double *HzA = FA->WBHz[Old][0], *HzB = FB->boundaryHz(Old);
+    int slots = slotE.size();
+
+    // The main grid updated the slots with its own Hz inside FB, replace that by the Hz of FB
+    for(int k=0; k<slots; k++)
+        interfaceE[k] = -slotWeight[k]*HzA[slotInside[k]];
+    for(int k=0; k<(int)toMain.size(); k++)
+        interfaceE[toMain[k].slot] += toMain[k].weight*HzB[toMain[k].h];
+    for(int k=0; k<slots; k++) {
+        double &E = (k < slotsEx ? Ex : Ey)[slotE[k]];
+        E += interfaceE[k];
+        interfaceE[k] = E;
     }
 
-    for(int j=jMin; j<jMin+FB->cellsY; j++) {
-        int i = iMin-1;
-        double C = FA->sigmaR[i][j]*dt/(2*FA->epsR[i][j]);
-        FA->WBEy[New][i][j] = (1-C)/(1+C)*FA->WBEy[Old][i][j] - dt/FA->epsR[i][j]/(1+C)*((0 - FA->WBHz[Old][i][j])/dx);     // Left
+    // Coupling to the subgrid
+    coupleSubgrid(interfaceE);
+}
 
-        i = iMax;
-        C = FA->sigmaR[i][j]*dt/(2*FA->epsR[i][j]);
-        FA->WBEy[New][i][j] = (1-C)/(1+C)*FA->WBEy[Old][i][j] - dt/FA->epsR[i][j]/(1+C)*((FA->WBHz[Old][i+1][j] - 0)/dx);   // Right
-    }
+void SGInterface::coupleSubgrid(const std::vector<double> &E)
+{
+    FB->s.setZero();
+    double *s = FB->s.data();
+    for(int k=0; k<(int)toSubgrid.size(); k++)
+        s[toSubgrid[k].h] += toSubgrid[k].weight*E[toSubgrid[k].slot];
+}
 
-    // And add the correction term from the subgrid
-    for(int i=0; i<FB->sizeHzx; i++) {
-        int j = jMin-1;
-        double factor = (i==0 || i==FB->sizeHzx-1 ? 1 : xRatio);
-        double C = FA->sigmaU[iMin+(int)(1+(i-1)/xRatio)][j]*dt/(2*FA->epsU[iMin+(int)(1+(i-1)/xRatio)][j]);
-        FA->WBEx[New][iMin+(int)(1+(i-1)/xRatio)][j] += dt/(FA->epsU[iMin+(int)(1+(i-1)/xRatio)][j]*(1+C)*dy)*FB->Hz(Old, i, 0)/factor;                  // Bottom
+void SGInterface::predictExplicit(int n)
+{
+    int Old = (n-1+sizeWorkBuffer)%sizeWorkBuffer;      // Old time
+    int M = FB->subSteps;
 
-        j = jMax;
-        C = FA->sigmaU[iMin+(int)(1+(i-1)/xRatio)][j]*dt/(2*FA->epsU[iMin+(int)(1+(i-1)/xRatio)][j]);
-        FA->WBEx[New][iMin+(int)(1+(i-1)/xRatio)][j] -= dt/(FA->epsU[iMin+(int)(1+(i-1)/xRatio)][j]*(1+C)*dy)*FB->Hz(Old, i, FB->sizeHzy-1)/factor;      // Top
+    // The Hz of the main grid next to FB is frozen, the E in between follows the local steps, starting from 0
+    const double *HzA = FA->WBHz[Old][0];
+    for(int k=0; k<(int)slotE.size(); k++) {
+        frozenHz[k] = HzA[slotOutside[k]];
+        localE[k] = 0;
     }
 
-    for(int j=0; j<FB->sizeHzy; j++) {
-        int i = iMin-1;
-        double factor = (j==0 || j==FB->sizeHzy-1 ? 1 : yRatio);
-        double C = FA->sigmaR[i][jMin+(int)(1+(j-1)/yRatio)]*dt/(2*FA->epsR[i][jMin+(int)(1+(j-1)/yRatio)]);
-        FA->WBEy[New][i][jMin+(int)(1+(j-1)/yRatio)] -= dt/(FA->epsR[i][jMin+(int)(1+(j-1)/yRatio)]*(1+C)*dx)*FB->Hz(Old, 0, j)/factor;                // Left
-
-        i = iMax;
-        C = FA->sigmaR[i][jMin+(int)(1+(j-1)/yRatio)]*dt/(2*FA->epsR[i][jMin+(int)(1+(j-1)/yRatio)]);
-        FA->WBEy[New][i][jMin+(int)(1+(j-1)/yRatio)] += dt/(FA->epsR[i][jMin+(int)(1+(j-1)/yRatio)]*(1+C)*dx)*FB->Hz(Old, FB->sizeHzx-1, j)/factor;    // Right
+    FB->startLocalSteps(Old);
+    stepInterface(0);
+    for(int m=1; m<M; m++) {
+        coupleSubgrid(localE);
+        FB->localStepH();
+        FB->localStepE(m);
+        stepInterface(m);
     }
+    FB->finishLocalSteps(Old);
+}
 
-    // Coupling to the subgrid
-    FB->s.setZero();
-    for(int i=0; i<FB->sizeHzx; i++) {
-        FB->s(FB->indexHz(i, 0)) -= dt/(FB->muC(i, 0)*dy)*FA->WBEx[New][iMin+(int)(1+(i-1)/xRatio)][jMin-1];     // Bottom
-        FB->s(FB->indexHz(i, FB->sizeHzy-1)) += dt/(FB->muC(i, FB->sizeHzy-1)*dy)*FA->WBEx[New][iMin+(int)(1+(i-1)/xRatio)][jMax];     // Top
-    }
+void SGInterface::stepInterface(int m)
+{
+    double decay = FB->localDecay[m], gain = FB->localGain[m];
+    const double *H = FB->localField.data();           // Same as the correction in advanceE, the outside Hz has the opposite factor
+    int slots = slotE.size();
+
+    for(int k=0; k<slots; k++)
+        interfaceE[k] = -slotWeight[k]*frozenHz[k];
+    for(int k=0; k<(int)toMain.size(); k++)
+        interfaceE[toMain[k].slot] += toMain[k].weight*H[toMain[k].h];
+    for(int k=0; k<slots; k++)
+        localE[k] = decay*localE[k] + gain*interfaceE[k];
+}
 
-    for(int j=0; j<FB->sizeHzy; j++) {
-        FB->s(FB->indexHz(0, j)) += dt/(FB->muC(0, j)*dx)*FA->WBEy[New][iMin-1][jMin+(int)(1+(j-1)/yRatio)];  // Left
-        FB->s(FB->indexHz(FB->sizeHzx-1, j)) -= dt/(FB->muC(FB->sizeHzx-1, j)*dx)*FA->WBEy[New][iMax][jMin+(int)(1+(j-1)/yRatio)];  // Right
-    }
+void SGInterface::initCoupling()
+{
+    int ny = 2*FA->settings.PMLlayers + FA->settings.cellsY;       // Row length of the main grid arrays
+    int cellsX = FB->cellsX, cellsY = FB->cellsY;
 
-    FB->updateFields(n);
-}
+    slotE.clear(); slotInside.clear(); slotOutside.clear(); slotWeight.clear();
+    for(int k=0; k<cellsX; k++) {           // Bottom, Ex at jMin-1
+        int i = iMin+k, j = jMin-1;
+        double C = FA->sigmaU[i][j]*dt/(2*FA->epsU[i][j]);
+        slotE.push_back(i*ny + j); slotInside.push_back(i*ny + j+1); slotOutside.push_back(i*ny + j);
+        slotWeight.push_back(dt/(FA->epsU[i][j]*(1+C)*dy));
+    }
+    for(int k=0; k<cellsX; k++) {           // Top, Ex at jMax
+        int i = iMin+k, j = jMax;
+        double C = FA->sigmaU[i][j]*dt/(2*FA->epsU[i][j]);
+        slotE.push_back(i*ny + j); slotInside.push_back(i*ny + j); slotOutside.push_back(i*ny + j+1);
+        slotWeight.push_back(-dt/(FA->epsU[i][j]*(1+C)*dy));
+    }
+    slotsEx = slotE.size();
+    for(int k=0; k<cellsY; k++) {           // Left, Ey at iMin-1
+        int i = iMin-1, j = jMin+k;
+        double C = FA->sigmaR[i][j]*dt/(2*FA->epsR[i][j]);
+        slotE.push_back(i*ny + j); slotInside.push_back((i+1)*ny + j); slotOutside.push_back(i*ny + j);
+        slotWeight.push_back(-dt/(FA->epsR[i][j]*(1+C)*dx));
+    }
+    for(int k=0; k<cellsY; k++) {           // Right, Ey at iMax
+        int i = iMax, j = jMin+k;
+        double C = FA->sigmaR[i][j]*dt/(2*FA->epsR[i][j]);
+        slotE.push_back(i*ny + j); slotInside.push_back(i*ny + j); slotOutside.push_back((i+1)*ny + j);
+        slotWeight.push_back(dt/(FA->epsR[i][j]*(1+C)*dx));
+    }
 
-void SGInterface::advanceH(int n) {
+    // Every Hz of FB on its edge belongs to the slot of the coarse cell it lies in, strip cells are xRatio (or yRatio) to a coarse cell
+    toMain.clear(); toSubgrid.clear();
+    for(int side=0; side<2; side++) {       // Bottom, top
+        int j = (side == 0 ? 0 : FB->sizeHzy-1);
+        for(int i=0; i<FB->sizeHzx; i++) {
+            double factor = (i==0 || i==FB->sizeHzx-1 ? 1 : xRatio);
+            int slot = side*cellsX + (int)(1+(i-1)/xRatio);
+            CouplingEntry a = {slot, FB->indexHz(i, j), slotWeight[slot]/factor};
+            CouplingEntry b = {slot, FB->indexHz(i, j), (side == 0 ? -1 : 1)*dt/(FB->muC(i, j)*dy)};
+            toMain.push_back(a);
+            toSubgrid.push_back(b);
+        }
+    }
+    for(int side=0; side<2; side++) {       // Left, right
+        int i = (side == 0 ? 0 : FB->sizeHzx-1);
+        for(int j=0; j<FB->sizeHzy; j++) {
+            double factor = (j==0 || j==FB->sizeHzy-1 ? 1 : yRatio);
+            int slot = slotsEx + side*cellsY + (int)(1+(j-1)/yRatio);
+            CouplingEntry a = {slot, FB->indexHz(i, j), slotWeight[slot]/factor};
+            CouplingEntry b = {slot, FB->indexHz(i, j), (side == 0 ? 1 : -1)*dt/(FB->muC(i, j)*dx)};
+            toMain.push_back(a);
+            toSubgrid.push_back(b);
+        }
+    }
 
+    interfaceE.assign(slotE.size(), 0);
+    frozenHz.assign(slotE.size(), 0);
+    localE.assign(slotE.size(), 0);
 }
 
 void SGInterface::computePosition(Settings settings)
@@ -21,27 +21,46 @@
 
 #include <vector>
 #include "point.h"
-#include "SGField.h"
+#include "sgfield.h"
 #include "field.h"
 #include "settings.h"
 
 class Field;        // field.h includes SGInterface.h, so forward declaration of field is needed
 
+struct CouplingEntry        // One term between an E sample of the main grid around FB (slot) and an Hz of FB (h)
+{
+    int slot, h;
+    double weight;
+};
+
 class SGInterface
 {
 public:
     SGInterface();
     SGInterface& operator=(const SGInterface& a);
-    void advanceH(int n);
-    void advanceE(int n);
+    void advanceE(int n);           // Correct the main grid E around FB and set FB->s, FB->updateFields(n) can run after this
+    void predictExplicit(int n);    // Local time steps of an explicit subgrid, before the main grid is corrected
+    void stepInterface(int m);      // Local step m of the main grid E around FB, with the Hz of FB and the frozen Hz outside
+    void coupleSubgrid(const std::vector<double> &E);      // FB->s from the E of the slots
     void computePosition(Settings settings);
+    void initCoupling();            // Build the slots and the coupling tables, once per run after FB is set up
 
     Field *FA=NULL;
     SGField *FB=NULL;
     std::vector<Point> p;                           // Position
     double index, xRatio=1, yRatio=1, dt, dx, dy;   // x and y refinement ratio
     int iMin, iMax, jMin, jMax;
+    int solverType=SGField::DirectLU;               // How FB solves its implicit system
+    double tolerance=1E-6;                          // Relative residual of the iterative solvers of FB
     int sizeWorkBuffer;
+
+    // The E of the main grid around FB, bottom and top (Ex) then left and right (Ey), are the slots
+    std::vector<int> slotE, slotInside, slotOutside;    // Flattened main grid index of E, and of the Hz inside and outside FB next to it
+    std::vector<double> slotWeight;                     // Factor of the inside Hz in the main grid E update
+    int slotsEx=0;                                      // The first slotsEx slots are Ex
+    std::vector<CouplingEntry> toMain;                  // E[slot] += weight*Hz of FB, ordered by slot
+    std::vector<CouplingEntry> toSubgrid;               // FB->s[h] += weight*E[slot]
+    std::vector<double> interfaceE, frozenHz, localE;   // Per slot, frozenHz and localE only during the local time steps
 };
 
 #endif // SGInterface_H
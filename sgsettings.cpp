@@ -16,8 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include "SGSettings.h"
-#include "ui_SGSettings.h"
+#include "sgsettings.h"
+#include "ui_sgsettings.h"
 
 SGSettings::SGSettings(SGInterface hsgSurface, std::vector<Point> &points, QPen &pen, QWidget *parent) :
     QDialog(parent),
@@ -50,6 +50,8 @@ void SGSettings::updateValues()
 {
     ui->xRatio->setValue(hsgSurface.xRatio);
     ui->yRatio->setValue(hsgSurface.yRatio);
+    ui->solver->setCurrentIndex(hsgSurface.solverType);
+    ui->tolerance->setValue(round(-log10(hsgSurface.tolerance)));
 }
 
 void SGSettings::on_ok_clicked()
@@ -75,6 +77,16 @@ void SGSettings::on_yRatio_valueChanged(int value)
     hsgSurface.yRatio = value;
 }
 
+void SGSettings::on_solver_currentIndexChanged(int index)
+{
+    hsgSurface.solverType = index;
+}
+
+void SGSettings::on_tolerance_valueChanged(int value)
+{
+    hsgSurface.tolerance = pow(10, -value);
+}
+
 void SGSettings::on_square_clicked()
 {
     if(plotted)
@@ -22,7 +22,7 @@
 #include <QDialog>
 #include <QPen>
 #include <QShortcut>
-#include "SGInterface.h"
+#include "sginterface.h"
 #include "coordinatetable.h"
 
 namespace Ui {
@@ -56,6 +56,8 @@ private slots:
     void on_cancel_clicked();
     void on_xRatio_valueChanged(int value);
     void on_yRatio_valueChanged(int value);
+    void on_solver_currentIndexChanged(int index);
+    void on_tolerance_valueChanged(int value);
     void on_square_clicked();
     void drawingFinished();
 };
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "simulation.h"
+
+Simulation::Simulation(QObject *parent) : QObject(parent)
+{
+    engine.finished = [this]() {
+        QMetaObject::invokeMethod(this, "engineFinished", Qt::QueuedConnection);
+    };
+}
+
+void Simulation::start(Settings settings, const std::vector<currentSource> &currentSources, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin,
+                       std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces)
+{
+    if(reportSteps)
+        engine.stepFinished = [this](int n) {
+            emit fieldUpdateFinished(n);            // Emitted from a worker thread, so the connection is queued
+        };
+    else
+        engine.stepFinished = nullptr;
+
+    engine.start(settings, currentSources, materials, thin, TFSF, sensors, hsgSurfaces);
+    field = engine.field;
+}
+
+void Simulation::resume(int extraSteps, std::vector<SensorDefinition> &sensors)
+{
+    engine.resume(extraSteps, sensors);
+}
+
+void Simulation::cancel()
+{
+    engine.cancel();
+}
+
+bool Simulation::isRunning()
+{
+    return engine.isRunning();
+}
+
+bool Simulation::canResume()
+{
+    return engine.canResume();
+}
+
+int Simulation::completedSteps()
+{
+    return engine.completedSteps();
+}
+
+void Simulation::engineFinished()
+{
+    engine.wait();          // The last thread called back just before returning
+    minEx = engine.minEx;
+    maxEx = engine.maxEx;
+    minEy = engine.minEy;
+    maxEy = engine.maxEy;
+    minHz = engine.minHz;
+    maxHz = engine.maxHz;
+    emit finished();
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <QObject>
+#include <vector>
+#include "engine.h"
+
+// Qt front end of Engine, the callbacks of the worker threads are turned into queued signals
+class Simulation : public QObject
+{
+    Q_OBJECT
+public:
+    Engine engine;
+    Field *field=NULL;              // The grid of the last run, owned by engine
+    bool reportSteps=true;          // Emit fieldUpdateFinished after every step, only needed when something is drawn during the run
+    double minEx=0, maxEx=0, minEy=0, maxEy=0, minHz=0, maxHz=0;
+
+    explicit Simulation(QObject *parent = 0);
+    void start(Settings settings, const std::vector<currentSource> &currentSources, const std::vector<MaterialDefinition> &materials, const std::vector<ThinDefinition> &thin,
+               std::vector<PlaneWave> &TFSF, std::vector<SensorDefinition> &sensors, std::vector<SGInterface> &hsgSurfaces);
+    void resume(int extraSteps, std::vector<SensorDefinition> &sensors);
+    void cancel();
+    bool isRunning();
+    bool canResume();
+    int completedSteps();
+
+private slots:
+    void engineFinished();
+
+signals:
+    void fieldUpdateFinished(int n);
+    void finished();
+};
+
+#endif // SIMULATION_H
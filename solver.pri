@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# Solver core, free of Qt, shared by fdtdcore, FDTD and FDTDbatch
+#
+#-------------------------------------------------
+
+SOURCES += settings.cpp \
+    field.cpp \
+    area.cpp \
+    pmlboundary.cpp \
+    currentsource.cpp \
+    materialdefinition.cpp \
+    thindefinition.cpp \
+    materialindex.cpp \
+    materialmap.cpp \
+    dispersion.cpp \
+    surfaceimpedance.cpp \
+    planewave.cpp \
+    point.cpp \
+    pointinpolygon.cpp \
+    sensordefinition.cpp \
+    sgfield.cpp \
+    sginterface.cpp \
+    gridpool.cpp \
+    resourceestimate.cpp \
+    subgridplacement.cpp \
+    engine.cpp
+
+HEADERS += settings.h \
+    field.h \
+    area.h \
+    pmlboundary.h \
+    currentsource.h \
+    materialdefinition.h \
+    thindefinition.h \
+    materialindex.h \
+    materialmap.h \
+    dispersion.h \
+    surfaceimpedance.h \
+    planewave.h \
+    point.h \
+    pointinpolygon.h \
+    sensordefinition.h \
+    sgfield.h \
+    sginterface.h \
+    gridpool.h \
+    resourceestimate.h \
+    subgridplacement.h \
+    threadsync.h \
+    engine.h
+
+CONFIG += c++11
+
+#INCLUDEPATH += "C:/fftwMinGW"
+
+QMAKE_CXXFLAGS += -O3
+#QMAKE_CXXFLAGS+= -openmp
+#QMAKE_LFLAGS +=  -openmp
+
+LIBS += -L/usr/local/lib -lfftw3
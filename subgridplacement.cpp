@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "subgridplacement.h"
+#include "materialindex.h"
+#include <algorithm>
+#include <cmath>
+
+#define c           299792458
+
+SubgridPlacement::SubgridPlacement(Settings settings, const std::vector<MaterialDefinition> &materials, double maxFrequency)
+{
+    settings.computeDifferentials();
+    this->settings = settings;
+    this->materials = materials;
+    this->maxFrequency = maxFrequency;
+}
+
+int SubgridPlacement::minimumCellsX() const
+{
+    if(maxFrequency <= 0)
+        return 0;
+
+    return ceil(settings.sizeX*maxFrequency*cellsPerWavelength/c);
+}
+
+int SubgridPlacement::minimumCellsY() const
+{
+    if(maxFrequency <= 0)
+        return 0;
+
+    return ceil(settings.sizeY*maxFrequency*cellsPerWavelength/c);
+}
+
+double SubgridPlacement::thickness(const std::vector<Point> &vertices)
+{
+    double area = 0, perimeter = 0;
+    int i, j, nvert = vertices.size();
+    for(i = 0, j = nvert-1; i < nvert; j = i++) {
+        area += vertices[j].x*vertices[i].y - vertices[i].x*vertices[j].y;
+        perimeter += sqrt(pow(vertices[i].x-vertices[j].x, 2) + pow(vertices[i].y-vertices[j].y, 2));
+    }
+    area = std::abs(area)/2;
+
+    // Shortest side of the rectangle with the same area and perimeter, round shapes have none and give a quarter of the perimeter
+    return (perimeter/2 - sqrt(std::max(perimeter*perimeter/4 - 4*area, 0.0)))/2;
+}
+
+bool SubgridPlacement::conflict(const Region &a, const Region &b)
+{
+    return a.x0 < b.x1+2 && b.x0 < a.x1+2 && a.y0 < b.y1+2 && b.y0 < a.y1+2;
+}
+
+std::vector<SGInterface> SubgridPlacement::propose(const std::vector<SGInterface> &existing) const
+{
+    double dx = settings.dx, dy = settings.dy;
+
+    // The interface needs two main grid cells between the subgrid and the PML, see SGInterface::computePosition for the offset
+    int xLow = ceil(2-settings.cellsX/2.0), xHigh = floor(settings.cellsX/2.0-2);
+    int yLow = ceil(2-settings.cellsY/2.0), yHigh = floor(settings.cellsY/2.0-2);
+
+    MaterialIndex index;
+    index.build(materials);
+    std::vector<int> inside;            // The materials that reach into the interior
+    index.query(xLow*dx, yLow*dy, xHigh*dx, yHigh*dy, inside);
+
+    std::vector<Region> regions;
+    for(int n=0; n<(int)inside.size(); n++) {
+        int k = inside[n];
+        const std::vector<Point> &vertices = index.polygons[k];
+        if(vertices.size() < 3)
+            continue;
+
+        // Refinement needed for the wavelength in the material and for the thinnest part
+        double xRatio = 1, yRatio = 1;
+        if(maxFrequency > 0) {
+            double cell = c/(maxFrequency*sqrt(materials[k].epsr*materials[k].mur))/cellsPerWavelength;
+            xRatio = std::max(xRatio, dx/cell);
+            yRatio = std::max(yRatio, dy/cell);
+        }
+        double t = thickness(vertices);
+        if(t > 0) {
+            xRatio = std::max(xRatio, cellsPerFeature*dx/t);
+            yRatio = std::max(yRatio, cellsPerFeature*dy/t);
+        }
+
+        Region r;
+        r.xRatio = std::min((int)ceil(xRatio-1E-9), maxRatio);
+        r.yRatio = std::min((int)ceil(yRatio-1E-9), maxRatio);
+        if(r.xRatio == 1 && r.yRatio == 1)
+            continue;
+
+        r.x0 = std::max((int)floor(index.xMin[k]/dx) - margin, xLow);
+        r.x1 = std::min((int)ceil(index.xMax[k]/dx) + margin, xHigh);
+        r.y0 = std::max((int)floor(index.yMin[k]/dy) - margin, yLow);
+        r.y1 = std::min((int)ceil(index.yMax[k]/dy) + margin, yHigh);
+        if(r.x1-r.x0 >= 3 && r.y1-r.y0 >= 3)
+            regions.push_back(r);
+    }
+
+    // Subgrids that come too close are merged into one with the finest ratio, until none are left
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(int a=0; a<(int)regions.size() && !merged; a++) {
+            for(int b=a+1; b<(int)regions.size() && !merged; b++) {
+                if(!conflict(regions[a], regions[b]))
+                    continue;
+
+                regions[a].x0 = std::min(regions[a].x0, regions[b].x0); regions[a].x1 = std::max(regions[a].x1, regions[b].x1);
+                regions[a].y0 = std::min(regions[a].y0, regions[b].y0); regions[a].y1 = std::max(regions[a].y1, regions[b].y1);
+                regions[a].xRatio = std::max(regions[a].xRatio, regions[b].xRatio);
+                regions[a].yRatio = std::max(regions[a].yRatio, regions[b].yRatio);
+                regions.erase(regions.begin()+b);
+                merged = true;
+            }
+        }
+    }
+
+    std::vector<Region> taken;              // The subgrids that are already defined, aligned the same way
+    for(int k=0; k<(int)existing.size(); k++) {
+        Region r;
+        r.x0 = ceil(std::min(existing[k].p[0].x, existing[k].p[1].x)/dx);
+        r.x1 = ceil(std::max(existing[k].p[0].x, existing[k].p[1].x)/dx);
+        r.y0 = ceil(std::min(existing[k].p[0].y, existing[k].p[1].y)/dy);
+        r.y1 = ceil(std::max(existing[k].p[0].y, existing[k].p[1].y)/dy);
+        taken.push_back(r);
+    }
+
+    std::vector<SGInterface> result;
+    for(int k=0; k<(int)regions.size(); k++) {
+        const Region &r = regions[k];
+        bool clear = (r.x1-r.x0)*(double)(r.y1-r.y0) <= maxAreaFraction*settings.cellsX*settings.cellsY;
+        for(int m=0; m<(int)taken.size() && clear; m++)
+            clear = !conflict(r, taken[m]);
+        if(!clear)
+            continue;
+
+        // Half a cell inside the corner, so the rounding up in SGField lands on it whatever the round-off
+        SGInterface a;
+        a.p.clear();
+        a.p.push_back(Point((r.x0-0.5)*dx, (r.y0-0.5)*dy));
+        a.p.push_back(Point((r.x1-0.5)*dx, (r.y1-0.5)*dy));
+        a.xRatio = r.xRatio;
+        a.yRatio = r.yRatio;
+        result.push_back(a);
+    }
+    return result;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SUBGRIDPLACEMENT_H
+#define SUBGRIDPLACEMENT_H
+
+#include <vector>
+#include "settings.h"
+#include "point.h"
+#include "materialdefinition.h"
+#include "sginterface.h"
+
+//
+// Looks for structures that the main grid does not resolve, thin parts or a short wavelength in the material,
+// and proposes a subgrid around them, so the main grid only has to resolve the free-space wavelength
+//
+class SubgridPlacement
+{
+public:
+    SubgridPlacement(Settings settings, const std::vector<MaterialDefinition> &materials, double maxFrequency);
+
+    int cellsPerWavelength=20;      // Cells per wavelength in the material at maxFrequency
+    int cellsPerFeature=4;          // Cells across the thinnest part of a structure
+    int maxRatio=16;                // Largest refinement ratio that is proposed
+    int margin=2;                   // Main grid cells between a structure and the interface of its subgrid
+    double maxAreaFraction=0.5;     // A subgrid covering more of the grid is not proposed, a finer main grid is cheaper then
+
+    std::vector<SGInterface> propose(const std::vector<SGInterface> &existing) const;     // New subgrids, kept clear of the existing ones
+    int minimumCellsX() const;      // Main grid cells that resolve the free-space wavelength, 0 without sources
+    int minimumCellsY() const;
+
+private:
+    struct Region                   // Corners in multiples of dx and dy, as SGField aligns them
+    {
+        int x0, y0, x1, y1;
+        int xRatio, yRatio;
+    };
+
+    Settings settings;
+    std::vector<MaterialDefinition> materials;
+    double maxFrequency;
+
+    static double thickness(const std::vector<Point> &vertices);                  // Estimate of the width of the thinnest part
+    static bool conflict(const Region &a, const Region &b);                       // Closer than the two cells the interfaces need
+};
+
+#endif // SUBGRIDPLACEMENT_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "surfaceimpedance.h"
+#include <cmath>
+#include <algorithm>
+
+#define mu0         1.2566370614E-6
+#define eta0        376.730313
+
+SurfaceImpedance::SurfaceImpedance()
+{
+}
+
+SurfaceImpedance::Fit SurfaceImpedance::fit(const MaterialDefinition &material, double dt, double omegaMin, double omegaMax)
+{
+    Fit f;
+    if(material.sigma <= 0)
+        return f;
+
+    // 1/sqrt(s) = 1/pi*integral of exp(v/2)/(s+exp(v)) dv, the trapezoidal rule with two poles a decade is accurate to 1E-4,
+    // the ends are three decades beyond the band
+    f.eta = sqrt(material.mur*mu0/material.sigma);
+    double h = log(10.0)/2;
+    int poles = ceil(log(1E6*omegaMax/omegaMin)/h) + 1;
+    std::vector<double> a;
+    for(int k=0; k<poles; k++) {
+        double v = log(1E-3*omegaMin) + k*h;
+        f.p.push_back(exp(v));
+        a.push_back(h*exp(v/2)/M_PI);
+        f.A += a.back();
+    }
+
+    // E lags Hz by half a step, Zs at high frequency, eta*A, has to stay well below the free space impedance or the update is unstable,
+    // a poor conductor loses its fastest poles
+    while(f.p.size() > 1 && f.eta*f.A > 0.4*eta0) {
+        f.A -= a.back();
+        a.pop_back();
+        f.p.pop_back();
+    }
+
+    for(int k=0; k<(int)f.p.size(); k++) {
+        f.decay.push_back(exp(-f.p[k]*dt));
+        f.gain.push_back(a[k]*(1-exp(-f.p[k]*dt))/f.p[k]);
+    }
+    return f;
+}
+
+double SurfaceImpedance::advance(Node &node, double Hz)
+{
+    // psi' = -p*psi + a*Hz, with Hz constant from n to n+1, E = eta*(A*Hz - sum(p*psi))
+    const Fit &f = fits[node.fit];
+    double sum = 0;
+    for(int k=0; k<(int)f.p.size(); k++) {
+        double &state = psi[node.first+k];
+        state = f.decay[k]*state + f.gain[k]*Hz;
+        sum += f.p[k]*state;
+    }
+    return node.sign*f.eta*(f.A*Hz - sum);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SURFACEIMPEDANCE_H
+#define SURFACEIMPEDANCE_H
+
+#include <vector>
+#include "materialdefinition.h"
+
+//
+// Surface impedance boundary of a good conductor: the tangential E on its surface follows from the Hz
+// just outside, E = Zs*Hz with Zs = sqrt(s*mu/sigma), so its inside does not have to resolve the skin depth
+// 1/sqrt(s) is fitted by a sum of real poles over the frequencies the run can represent, every pole
+// keeps one recursive convolution per surface node
+//
+class SurfaceImpedance
+{
+public:
+    struct Fit {
+        double eta=0, A=0;                      // Zs = eta*s*sum(a/(s+p)), A = sum(a)
+        std::vector<double> p, decay, gain;     // Pole, exp(-p*dt) and a*(1-exp(-p*dt))/p
+    };
+
+    struct Node {
+        int i, j;
+        char component;                         // 'x' for Ex, 'y' for Ey
+        int iH, jH;                             // The Hz just outside
+        double sign;                            // +1 if E = Zs*Hz, -1 if E = -Zs*Hz, which side the conductor is on
+        int fit, first;                         // Its states are psi[first] on
+    };
+
+    SurfaceImpedance();
+    static Fit fit(const MaterialDefinition &material, double dt, double omegaMin, double omegaMax);
+    double advance(Node &node, double Hz);      // E at n+1 from Hz at n+1/2
+
+    std::vector<Fit> fits;                      // One for every material, empty if it has no surface impedance
+    std::vector<Node> nodes;
+    std::vector<double> psi;
+};
+
+#endif // SURFACEIMPEDANCE_H
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef THINDEFINITION_H
+#define THINDEFINITION_H
+
+#include <vector>
+#include "point.h"
+
+// A sheet or wire thinner than a cell, it changes the parameters of the cells it goes through instead of needing cells of its own
+class ThinDefinition
+{
+public:
+    std::vector<Point> p;       // The sheet runs along the points, a wire (along z) stands at the first one
+    char type='s';              // 's': sheet, 'w': wire
+    double thickness=35E-6;     // [m] Thickness of the sheet, radius of the wire
+    double epsr=1, sigma=5.8E7; // Of the sheet, a wire is taken as a perfect conductor
+    int index=0;                // -1 during first creation, as for a material
+    bool plotted=false;
+
+    ThinDefinition();
+    ThinDefinition& operator=(const ThinDefinition& a);
+};
+
+#endif // THINDEFINITION_H
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "thinsettings.h"
+#include "ui_thinsettings.h"
+#include <QShortcut>
+
+ThinSettings::ThinSettings(ThinDefinition thin, std::vector<Point> &points, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::ThinSettings)
+{
+    ui->setupUi(this);
+    this->setWindowTitle("Settings");
+    this->thin = thin;
+    this->points = &points;
+
+    model = new CoordinateTable(this->thin.p, this);
+    ui->coordinates->setModel(model);
+    updateValues();
+    new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_W), this, SLOT(close()));
+}
+
+ThinSettings::~ThinSettings()
+{
+    delete ui;
+}
+
+void ThinSettings::on_Ok_clicked()
+{
+    if(thin.type == 'w' && thin.p.size() > 1)          // A wire only has one point
+        thin.p.resize(1);
+    emit Ok_clicked(thin);
+    this->deleteLater();
+}
+
+void ThinSettings::on_Cancel_clicked()
+{
+    if(drawn > 0)
+        emit clearLastDrawnStructure(drawn);
+    this->deleteLater();
+}
+
+void ThinSettings::on_grid_clicked()
+{
+    if(drawn > 0)
+        emit clearLastDrawnStructure(drawn);
+    points->clear();
+
+    this->setVisible(false);
+    if(thin.type == 'w')
+        emit drawPoint();
+    else
+        emit drawPolygon();
+}
+
+void ThinSettings::drawingFinished()
+{
+    this->setVisible(true);
+    thin.p.clear();
+    for(int k=0; k<(*points).size(); k++)
+        thin.p.push_back((*points)[k]);
+    drawn = thin.type == 'w' ? 1 : thin.p.size();     // The polygon tool also closes the line
+    points->clear();
+
+    model->updateView();
+}
+
+void ThinSettings::updateValues()
+{
+    ui->type->setCurrentIndex(thin.type == 'w' ? 1 : 0);
+    on_type_currentIndexChanged(ui->type->currentIndex());     // Not emitted if the index stays the same
+    ui->thickness->setValue(thin.thickness*1E6);
+    ui->epsr->setValue(thin.epsr);
+    ui->sigma->setValue(thin.sigma);
+}
+
+void ThinSettings::on_type_currentIndexChanged(int index)
+{
+    thin.type = index == 1 ? 'w' : 's';
+    ui->label_thickness->setText(index == 1 ? "radius [um]" : "thickness [um]");
+    ui->epsr->setEnabled(index == 0);           // A wire is a conductor
+    ui->sigma->setEnabled(index == 0);
+}
+
+void ThinSettings::on_thickness_valueChanged(double value)
+{
+    thin.thickness = value*1E-6;
+}
+
+void ThinSettings::on_epsr_valueChanged(double value)
+{
+    thin.epsr = value;
+}
+
+void ThinSettings::on_sigma_valueChanged(double value)
+{
+    thin.sigma = value;
+}
+
+void ThinSettings::closeEvent(QCloseEvent *event) {
+    on_Cancel_clicked();
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef THINSETTINGS_H
+#define THINSETTINGS_H
+
+#include <QDialog>
+#include "thindefinition.h"
+#include "point.h"
+#include "coordinatetable.h"
+
+namespace Ui {
+class ThinSettings;
+}
+
+class ThinSettings : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ThinDefinition thin;
+    std::vector<Point> *points;
+
+    explicit ThinSettings(ThinDefinition thin, std::vector<Point> &points, QWidget *parent = 0);
+    ~ThinSettings();
+    void updateValues();
+    void closeEvent(QCloseEvent *event);
+
+private slots:
+    void on_Ok_clicked();
+    void on_Cancel_clicked();
+    void on_grid_clicked();
+    void on_type_currentIndexChanged(int index);
+    void on_thickness_valueChanged(double value);
+    void on_epsr_valueChanged(double value);
+    void on_sigma_valueChanged(double value);
+
+public slots:
+    void drawingFinished();
+
+signals:
+    void Ok_clicked(ThinDefinition);
+    void drawPoint();
+    void drawPolygon();
+    void clearLastDrawnStructure(int);
+
+private:
+    int drawn = 0;              // Items on the plot from the last drawing
+    CoordinateTable *model;
+    Ui::ThinSettings *ui;
+};
+
+#endif // THINSETTINGS_H
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2015-2016 Bert De Deckere
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef THREADSYNC_H
+#define THREADSYNC_H
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <memory>
+#include <algorithm>
+
+// Barrier shared by the threads which work on one grid, together with the run's callbacks
+class ThreadSync
+{
+public:
+    std::mutex mutex;
+    std::condition_variable computation;
+    int threadCounter=0;                // Number of threads waiting at the barrier
+    int generation=0;                   // Incremented every time the barrier opens, so spurious wake ups are ignored
+    bool stopped=false;                 // Copy of cancel taken when the barrier opens, every thread stops at the same step
+    std::atomic<bool> cancel;           // Request to stop the run, may be set from any thread
+    std::deque<std::function<void()>> tasks;    // Subgrid solves, run by whichever thread is waiting
+    int runningTasks=0;
+    int workers=1;                      // Threads that take tasks, parallelFor runs serially with a single one
+
+    std::function<void(int)> stepFinished;                                                  // Called after every step by the last thread to arrive
+    std::function<void(double, double, double, double, double, double)> threadFinished;     // Called by every thread when it is done, with its extrema of Ex, Ey and Hz
+
+    ThreadSync() : cancel(false) {}
+
+    void reset()
+    {
+        threadCounter = 0;
+        stopped = false;
+        cancel = false;
+        tasks.clear();
+        runningTasks = 0;
+    }
+
+    // Queue work for the threads that are waiting at a barrier or in finishTasks
+    void post(std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        computation.notify_all();
+    }
+
+    // Help with the queued tasks until every one of them is done
+    void finishTasks()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!tasks.empty() || runningTasks > 0) {
+            if(!tasks.empty())
+                runTask(lock);
+            else
+                computation.wait(lock);
+        }
+    }
+
+    // Run body(first, last) over [0, count) in blocks of at least grain, shared with the threads that take tasks
+    // The caller works on the blocks itself and only waits for those already started elsewhere, so it may run inside a task
+    template<typename F> void parallelFor(int count, int grain, F body)
+    {
+        int blocks = std::min(count/std::max(grain, 1), 4*workers);
+        if(workers < 2 || blocks < 2) {
+            body(0, count);
+            return;
+        }
+
+        struct Batch {
+            std::atomic<int> next, done;
+            std::mutex mutex;
+            std::condition_variable finished;
+            Batch() : next(0), done(0) {}
+        };
+        std::shared_ptr<Batch> batch = std::make_shared<Batch>();      // A helper may only start after the batch is done
+        F *work = &body;
+        std::function<void()> help = [batch, blocks, count, work] {
+            for(int b = batch->next++; b < blocks; b = batch->next++) {
+                (*work)((int)((long long)count*b/blocks), (int)((long long)count*(b+1)/blocks));
+                if(++batch->done == blocks) {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->finished.notify_all();
+                }
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for(int k=0; k<std::min(blocks, workers)-1; k++)
+                tasks.push_back(help);
+            computation.notify_all();
+        }
+        help();
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        while(batch->done < blocks)
+            batch->finished.wait(lock);
+    }
+
+    // Wait for the other threads, the last one to arrive runs last() before releasing them
+    // While waiting a thread runs queued tasks, so it may leave the barrier some time after it opened
+    // Returns false once the run is cancelled
+    template<typename F> bool synchronize(int numberOfThreads, F last)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        threadCounter++;
+        if(threadCounter < numberOfThreads) {
+            int current = generation;
+            while(generation == current) {          // Wait for the other threads to synchronize
+                if(!tasks.empty())
+                    runTask(lock);
+                else
+                    computation.wait(lock);
+            }
+        }
+        else {
+            threadCounter = 0;
+            last();
+            stopped = cancel;
+            generation++;
+            computation.notify_all();
+        }
+        return !stopped;
+    }
+
+    bool synchronize(int numberOfThreads)
+    {
+        return synchronize(numberOfThreads, []{});
+    }
+
+private:
+    void runTask(std::unique_lock<std::mutex> &lock)       // Called with the lock held, released while the task runs
+    {
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        runningTasks++;
+        lock.unlock();
+        task();
+        lock.lock();
+        runningTasks--;
+        computation.notify_all();           // Threads in finishTasks may be waiting for this one
+    }
+};
+
+#endif // THREADSYNC_H